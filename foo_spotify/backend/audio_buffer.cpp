@@ -2,111 +2,408 @@
 
 #include "audio_buffer.h"
 
+#include <fb2k/advanced_config.h>
 #include <utils/abort_manager.h>
 
+namespace
+{
+
+using namespace sptf;
+
+bool IsPadding( const AudioBuffer::AudioChunkHeader& header )
+{ // audio chunks always have channels, eof chunk has a flag
+    return ( !header.channels && !header.eof );
+}
+
+} // namespace
+
 namespace sptf
 {
 
-AudioBuffer::AudioBuffer( AbortManager& abortManager )
+AudioBuffer::AudioBuffer( AbortManager& abortManager, std::function<void()> onDrained )
     : abortManager_( abortManager )
+    , onDrained_( onDrained )
 {
 }
 
 bool AudioBuffer::write( AudioChunkHeader header, const uint16_t* data )
 {
+    if ( isThrottled_.load( std::memory_order_acquire ) )
     {
-        std::lock_guard lock( posMutex_ );
+        statsRefusedWrites_.fetch_add( 1, std::memory_order_relaxed );
+        return false;
+    }
 
-        const size_t readPos = readPos_;
-        const size_t writePos = writePos_;
-        const size_t waterMark = waterMark_;
-        const size_t writeSize = k_headerSizeInU16 + header.size;
+    if ( !write_impl( header, data ) )
+    {
+        statsRefusedWrites_.fetch_add( 1, std::memory_order_relaxed );
+        start_throttling();
+        return false;
+    }
 
-        const auto writeData = [&]( size_t writePos ) {
-            const auto curBufferPos = begin_ + writePos;
-            std::copy( &header, &header + 1, reinterpret_cast<AudioChunkHeader*>( curBufferPos ) );
-            std::copy( data, data + header.size, curBufferPos + k_headerSizeInU16 );
-        };
+    const size_t fill = writePos_.load( std::memory_order_relaxed ) - readPos_.load( std::memory_order_relaxed );
+    if ( fill >= size_ * k_highWatermarkInPercent / 100 )
+    {
+        start_throttling();
+    }
 
-        // TODO: simplify the code
-        if ( writePos >= readPos ) // write leads
-        {
-            if ( size_ - writePos >= writeSize )
-            {
-                writeData( writePos );
-
-                writePos_ = writePos + writeSize;
-                waterMark_ = size_;
-            }
-            else // wrap-around
-            {
-                if ( !readPos || readPos - 1 < writeSize )
-                {
-                    return false;
-                }
-
-                writeData( 0 );
-
-                writePos_ = writeSize;
-                waterMark_ = writePos;
-            }
-        }
-        else // read leads
-        {
-            if ( readPos - 1 - writePos < writeSize )
-            {
-                return false;
-            }
+    return true;
+}
+
+uint64_t AudioBuffer::write_end()
+{
+    uint16_t dummy{};
+    write_impl( AudioChunkHeader{ 0, 0, 0, 1 }, &dummy );
+    return writePos_.load( std::memory_order_relaxed );
+}
 
-            writeData( writePos );
+bool AudioBuffer::write_impl( AudioChunkHeader header, const uint16_t* data )
+{
+    const uint64_t writePos = writePos_.load( std::memory_order_relaxed );
+    const uint64_t readPos = readPos_.load( std::memory_order_acquire );
+    const size_t writeSize = k_headerSizeInU16 + header.size;
 
-            writePos_ = writePos + writeSize;
-        }
+    if ( !begin_ )
+    {
+        allocate( header, writeSize );
     }
 
-    dataCv_.notify_all();
+    const size_t bufferOffset = writePos % size_;
+    const size_t tailSize = ( size_ - bufferOffset >= writeSize ? 0 : size_ - bufferOffset );
+    if ( size_ - ( writePos - readPos ) < tailSize + writeSize )
+    {
+        return false;
+    }
+
+    if ( tailSize >= k_headerSizeInU16 )
+    {
+        const AudioChunkHeader padding{ 0, 0, static_cast<uint32_t>( tailSize - k_headerSizeInU16 ), 0 };
+        std::copy( &padding, &padding + 1, reinterpret_cast<AudioChunkHeader*>( begin_ + bufferOffset ) );
+    }
+
+    const auto curBufferPos = begin_ + ( writePos + tailSize ) % size_;
+    std::copy( &header, &header + 1, reinterpret_cast<AudioChunkHeader*>( curBufferPos ) );
+    std::copy( data, data + header.size, curBufferPos + k_headerSizeInU16 );
+
+    const uint64_t newWritePos = writePos + tailSize + writeSize;
+    if ( const size_t fill = newWritePos - readPos; fill > statsPeakFill_.load( std::memory_order_relaxed ) )
+    {
+        statsPeakFill_.store( fill, std::memory_order_relaxed );
+    }
+
+    // seq_cst: pairs with `isConsumerWaiting_` (see `wait_for_data`)
+    writePos_.store( newWritePos, std::memory_order_seq_cst );
+
+    notify_consumer();
     return true;
 }
 
-void AudioBuffer::write_end()
+void AudioBuffer::flush()
 {
-    uint16_t dummy{};
-    write( AudioChunkHeader{ 0, 0, 0, 1 }, &dummy );
+    flushPos_.store( writePos_.load( std::memory_order_relaxed ), std::memory_order_release );
 }
 
 bool AudioBuffer::has_data() const
 {
-    std::lock_guard lock( posMutex_ );
-
-    return has_data_no_lock();
+    const uint64_t readPos = std::max( readPos_.load( std::memory_order_relaxed ), flushPos_.load( std::memory_order_acquire ) );
+    return ( readPos != writePos_.load( std::memory_order_seq_cst ) );
 }
 
 bool AudioBuffer::wait_for_data( abort_callback& abort )
 {
-    const auto abortableScope = abortManager_.GetAbortableScope( [&] { dataCv_.notify_all(); }, abort );
+    const auto abortableScope = abortManager_.GetAbortableScope( [&] {
+        {
+            std::lock_guard lock( waitMutex_ );
+        }
+        dataCv_.notify_all();
+    },
+                                                                 abort );
 
-    std::unique_lock lock( posMutex_ );
+    std::unique_lock lock( waitMutex_ );
+    isConsumerWaiting_.store( true, std::memory_order_seq_cst );
     dataCv_.wait( lock, [&] {
-        return ( has_data_no_lock() || abort.is_aborting() );
+        return ( has_data() || abort.is_aborting() );
     } );
-    return has_data_no_lock();
+    isConsumerWaiting_.store( false, std::memory_order_relaxed );
+
+    return has_data();
+}
+
+std::optional<AudioBuffer::AudioChunk> AudioBuffer::peek()
+{
+    const auto readPosOpt = find_chunk_to_read();
+    if ( !readPosOpt )
+    {
+        peekedChunkEndPos_.reset();
+        return std::nullopt;
+    }
+
+    const auto readPos = *readPosOpt;
+    const auto curBufferPos = begin_ + readPos % size_;
+    const auto& header = *reinterpret_cast<const AudioChunkHeader*>( curBufferPos );
+
+    peekedChunkEndPos_ = readPos + k_headerSizeInU16 + header.size;
+    return AudioChunk{ header, nonstd::span<const uint16_t>( curBufferPos + k_headerSizeInU16 + readOffset_, header.size - readOffset_ ) };
+}
+
+void AudioBuffer::commit_read()
+{
+    assert( peekedChunkEndPos_ );
+    if ( !peekedChunkEndPos_ )
+    {
+        return;
+    }
+
+    // seq_cst: pairs with `isThrottled_` (see `update_throttling`)
+    readPos_.store( *peekedChunkEndPos_, std::memory_order_seq_cst );
+    peekedChunkEndPos_.reset();
+    readOffset_ = 0;
+
+    update_throttling();
+}
+
+void AudioBuffer::commit_read( size_t sampleCount )
+{
+    assert( peekedChunkEndPos_ );
+    if ( !peekedChunkEndPos_ )
+    {
+        return;
+    }
+
+    const auto& header = *reinterpret_cast<const AudioChunkHeader*>( begin_ + readPos_.load( std::memory_order_relaxed ) % size_ );
+    if ( readOffset_ + sampleCount >= header.size )
+    {
+        commit_read();
+        return;
+    }
+
+    // chunk is still in use, so `readPos_` stays the same
+    readOffset_ += sampleCount;
+    peekedChunkEndPos_.reset();
+}
+
+bool AudioBuffer::skip( size_t sampleCount )
+{
+    while ( sampleCount )
+    {
+        const auto chunkOpt = peek();
+        if ( !chunkOpt || chunkOpt->header.eof )
+        {
+            return false;
+        }
+
+        const auto chunkSize = chunkOpt->data.size();
+        commit_read( std::min( sampleCount, chunkSize ) );
+        sampleCount -= std::min( sampleCount, chunkSize );
+    }
+
+    return true;
 }
 
 void AudioBuffer::clear()
 {
+    peekedChunkEndPos_.reset();
+    readOffset_ = 0;
+    readPos_.store( writePos_.load( std::memory_order_acquire ), std::memory_order_seq_cst );
+
+    update_throttling();
+}
+
+void AudioBuffer::release()
+{
+    buffer_.reset();
+    begin_ = nullptr;
+    size_ = 0;
+
+    readPos_ = 0;
+    writePos_ = 0;
+    flushPos_ = 0;
+    peekedChunkEndPos_.reset();
+    readOffset_ = 0;
+
+    isThrottled_ = false;
+    throttleStartTime_ = 0;
+
+    statsSize_ = 0;
+    statsPeakFill_ = 0;
+    statsSamplesPerSec_ = 0;
+    statsChannels_ = 0;
+    statsRefusedWrites_ = 0;
+    statsTimeFull_ = 0;
+    statsUnderruns_ = 0;
+    stutterCount_ = 0;
+}
+
+void AudioBuffer::report_underrun()
+{
+    statsUnderruns_.fetch_add( 1, std::memory_order_relaxed );
+    stutterCount_.fetch_add( 1, std::memory_order_relaxed );
+}
+
+AudioBuffer::Stats AudioBuffer::get_stats() const
+{
+    const size_t size = statsSize_.load( std::memory_order_relaxed );
+    const size_t peakFill = statsPeakFill_.load( std::memory_order_relaxed );
+    const uint32_t samplesPerSec = statsSamplesPerSec_.load( std::memory_order_relaxed );
+
+    const auto toMs = [samplesPerSec]( size_t samples ) -> uint32_t {
+        return ( samplesPerSec ? static_cast<uint32_t>( samples * 1000 / samplesPerSec ) : 0 );
+    };
+
+    auto timeFull = std::chrono::steady_clock::duration( statsTimeFull_.load( std::memory_order_relaxed ) );
+    if ( isThrottled_.load( std::memory_order_acquire ) )
     {
-        std::lock_guard lock( posMutex_ );
+        timeFull += std::chrono::steady_clock::now().time_since_epoch()
+                    - std::chrono::steady_clock::duration( throttleStartTime_.load( std::memory_order_relaxed ) );
+    }
+
+    return Stats{ size * sizeof( uint16_t ),
+                  toMs( size ),
+                  toMs( peakFill ),
+                  statsRefusedWrites_.load( std::memory_order_relaxed ),
+                  static_cast<uint32_t>( std::chrono::duration_cast<std::chrono::milliseconds>( timeFull ).count() ),
+                  statsUnderruns_.load( std::memory_order_relaxed ) };
+}
+
+uint64_t AudioBuffer::get_read_pos() const
+{
+    return std::max( readPos_.load( std::memory_order_acquire ), flushPos_.load( std::memory_order_acquire ) );
+}
 
-        readPos_ = 0;
-        writePos_ = 0;
-        waterMark_ = size_;
+size_t AudioBuffer::get_buffered_frames() const
+{
+    const uint16_t channels = statsChannels_.load( std::memory_order_relaxed );
+    if ( !channels )
+    { // not allocated yet
+        return 0;
     }
-    dataCv_.notify_all();
+
+    const uint64_t writePos = writePos_.load( std::memory_order_acquire );
+    const uint64_t readPos = std::max( readPos_.load( std::memory_order_acquire ), flushPos_.load( std::memory_order_acquire ) );
+    return ( writePos > readPos ? static_cast<size_t>( writePos - readPos ) / channels : 0 );
+}
+
+uint32_t AudioBuffer::take_stutter_count()
+{
+    return stutterCount_.exchange( 0, std::memory_order_relaxed );
 }
 
-bool AudioBuffer::has_data_no_lock() const
+void AudioBuffer::allocate( const AudioChunkHeader& header, size_t minSize )
 {
-    return ( readPos_ != writePos_ );
+    // eof chunk does not contain format info, but libspotify always outputs 44.1kHz stereo anyway
+    const uint32_t samplesPerSec = ( header.channels ? header.sampleRate * header.channels : 44100 * 2 );
+    const uint64_t sizeInMs = config::advanced::playback_buffer_size_in_ms.GetValue();
+
+    size_ = std::max<size_t>( static_cast<size_t>( samplesPerSec * sizeInMs / 1000 ), 2 * minSize );
+    buffer_ = std::make_unique<uint16_t[]>( size_ );
+    begin_ = buffer_.get();
+
+    statsSize_ = size_;
+    statsPeakFill_ = 0;
+    statsSamplesPerSec_ = samplesPerSec;
+    statsChannels_ = ( header.channels ? header.channels : 2 );
+}
+
+void AudioBuffer::start_throttling()
+{
+    throttleStartTime_.store( std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed );
+    // seq_cst: pairs with `readPos_` (see `update_throttling`)
+    isThrottled_.store( true, std::memory_order_seq_cst );
+
+    // consumer might have drained the buffer before it could see the flag
+    const size_t fill = writePos_.load( std::memory_order_relaxed ) - readPos_.load( std::memory_order_seq_cst );
+    if ( fill <= size_ * k_lowWatermarkInPercent / 100 )
+    { // no need to notify: producer is already running
+        stop_throttling( false );
+    }
+}
+
+void AudioBuffer::stop_throttling( bool shouldNotify )
+{
+    bool expected = true;
+    if ( !isThrottled_.compare_exchange_strong( expected, false, std::memory_order_acq_rel ) )
+    { // someone else has already done it
+        return;
+    }
+
+    const auto throttleTime = std::chrono::steady_clock::now().time_since_epoch().count() - throttleStartTime_.load( std::memory_order_relaxed );
+    statsTimeFull_.fetch_add( throttleTime, std::memory_order_relaxed );
+
+    if ( shouldNotify && onDrained_ )
+    {
+        onDrained_();
+    }
+}
+
+void AudioBuffer::update_throttling()
+{
+    if ( !isThrottled_.load( std::memory_order_seq_cst ) )
+    {
+        return;
+    }
+
+    // `size_` is safe to access here, since throttling can only be started after allocation
+    const size_t fill = writePos_.load( std::memory_order_acquire ) - readPos_.load( std::memory_order_relaxed );
+    if ( fill > size_ * k_lowWatermarkInPercent / 100 )
+    {
+        return;
+    }
+
+    stop_throttling( true );
+}
+
+std::optional<uint64_t> AudioBuffer::find_chunk_to_read()
+{
+    const uint64_t initialReadPos = readPos_.load( std::memory_order_relaxed );
+    const uint64_t flushPos = flushPos_.load( std::memory_order_acquire );
+    const uint64_t writePos = writePos_.load( std::memory_order_acquire );
+
+    uint64_t readPos = std::max( initialReadPos, flushPos );
+    while ( readPos != writePos )
+    {
+        const size_t bufferOffset = readPos % size_;
+        if ( size_ - bufferOffset < k_headerSizeInU16 )
+        { // too small for padding
+            readPos += size_ - bufferOffset;
+            continue;
+        }
+
+        const auto& header = *reinterpret_cast<const AudioChunkHeader*>( begin_ + bufferOffset );
+        if ( IsPadding( header ) )
+        {
+            readPos += k_headerSizeInU16 + header.size;
+            continue;
+        }
+
+        break;
+    }
+
+    if ( readPos != initialReadPos )
+    { // offset is relevant only for the chunk at the initial position
+        readOffset_ = 0;
+        readPos_.store( readPos, std::memory_order_seq_cst );
+        update_throttling();
+    }
+
+    if ( readPos == writePos )
+    {
+        return std::nullopt;
+    }
+
+    return readPos;
+}
+
+void AudioBuffer::notify_consumer()
+{
+    if ( !isConsumerWaiting_.load( std::memory_order_seq_cst ) )
+    {
+        return;
+    }
+
+    {
+        std::lock_guard lock( waitMutex_ );
+    }
+    dataCv_.notify_all();
 }
 
 } // namespace sptf
@@ -2,20 +2,27 @@
 
 #include <nonstd/span.hpp>
 
-#include <array>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
 #include <mutex>
+#include <optional>
 
 namespace sptf
 {
 
 class AbortManager;
 
-// TODO: bench and replace with lock-free if needed
+/// Lock-free single-producer/single-consumer buffer.
+/// Producer methods: `write`, `write_end`, `flush`.
+/// Consumer methods: `peek`, `commit_read`, `read`, `skip`, `has_data`, `wait_for_data`, `clear`, `report_underrun`.
+/// Memory is allocated by producer on the first write and is held until `release` is called.
+/// Once the fill level reaches the high watermark, `write` refuses new data until consumer
+/// drains the buffer below the low watermark, after which `onDrained` callback is invoked.
 class AudioBuffer
 {
-    static constexpr size_t k_maxBufferSize = 8UL * 1024 * 1024;
-
 public:
 #pragma pack( push )
 #pragma pack( 1 )
@@ -28,15 +35,52 @@ public:
     };
 #pragma pack( pop )
 
+    struct AudioChunk
+    {
+        AudioChunkHeader header;
+        nonstd::span<const uint16_t> data;
+    };
+
+    struct Stats
+    {
+        size_t sizeInBytes;
+        uint32_t sizeInMs;
+        uint32_t peakFillInMs;
+        uint64_t refusedWrites;
+        uint32_t timeFullInMs;
+        uint64_t underruns;
+    };
+
 private:
     static constexpr size_t k_headerSizeInU16 = sizeof( AudioChunkHeader ) / sizeof( uint16_t );
+    static constexpr size_t k_highWatermarkInPercent = 90;
+    static constexpr size_t k_lowWatermarkInPercent = 50;
 
 public:
-    AudioBuffer( AbortManager& abortManager );
+    /// @param onDrained invoked from consumer thread
+    AudioBuffer( AbortManager& abortManager, std::function<void()> onDrained );
     ~AudioBuffer() = default;
 
     bool write( AudioChunkHeader header, const uint16_t* data );
-    void write_end();
+    /// Ignores watermarks
+    /// @return position right after the eof marker
+    uint64_t write_end();
+    /// Discards all the data that was written before this call
+    void flush();
+
+    /// Returns the next chunk without consuming it.
+    /// Chunk data stays valid and is not overwritten by producer until `commit_read` is called.
+    /// If the chunk was partially consumed, `data` contains only the unread part.
+    std::optional<AudioChunk> peek();
+    /// Consumes the chunk returned by the last `peek`.
+    void commit_read();
+    /// Consumes `sampleCount` samples of the chunk returned by the last `peek`.
+    void commit_read( size_t sampleCount );
+
+    /// Consumes `sampleCount` samples of the currently available data.
+    /// Stops at eof chunk without consuming it.
+    /// @return false, if there was not enough data available
+    bool skip( size_t sampleCount );
 
     template <typename Fn>
     bool read( Fn fn );
@@ -46,44 +90,87 @@ public:
 
     void clear();
 
+    /// Frees the memory.
+    /// Must not be called while producer or consumer is active.
+    void release();
+    /// Should be called by consumer when it runs out of data in the middle of the stream
+    void report_underrun();
+
+    /// Can be called from any thread
+    Stats get_stats() const;
+    /// Can be called from any thread.
+    /// @return position of the first unconsumed data: data before it was either consumed or discarded
+    uint64_t get_read_pos() const;
+    /// Can be called from any thread.
+    /// Approximate: includes chunk headers.
+    size_t get_buffered_frames() const;
+    /// Can be called from any thread.
+    /// @return number of underruns since the last call
+    uint32_t take_stutter_count();
+
 private:
-    bool has_data_no_lock() const;
+    void allocate( const AudioChunkHeader& header, size_t minSize );
+    bool write_impl( AudioChunkHeader header, const uint16_t* data );
+
+    void start_throttling();
+    void stop_throttling( bool shouldNotify );
+    /// Should be called by consumer after each `readPos_` update
+    void update_throttling();
+
+    /// @return position of the next chunk if it's available
+    std::optional<uint64_t> find_chunk_to_read();
+
+    void notify_consumer();
 
 private:
     AbortManager& abortManager_;
+    std::function<void()> onDrained_;
 
-    std::array<uint16_t, k_maxBufferSize> buffer_;
-    uint16_t* begin_ = buffer_.data();
-    static constexpr size_t size_ = k_maxBufferSize;
+    // producer-owned, published to consumer via `writePos_`
+    std::unique_ptr<uint16_t[]> buffer_;
+    uint16_t* begin_ = nullptr;
+    size_t size_ = 0;
 
-    mutable std::mutex posMutex_;
-    std::condition_variable dataCv_;
+    // Positions are monotonic counters (in u16 units), buffer offset is `pos % size_`.
+    // Chunks never wrap around: the tail that can't fit a chunk is skipped
+    // (with padding chunk if it has enough space for a header).
+    std::atomic<uint64_t> readPos_ = 0;
+    std::atomic<uint64_t> writePos_ = 0;
+    std::atomic<uint64_t> flushPos_ = 0;
 
-    size_t readPos_ = 0;
-    size_t writePos_ = 0;
-    size_t waterMark_ = size_;
+    std::mutex waitMutex_;
+    std::condition_variable dataCv_;
+    std::atomic_bool isConsumerWaiting_ = false;
+
+    std::atomic_bool isThrottled_ = false;
+    std::atomic<std::chrono::steady_clock::rep> throttleStartTime_ = 0;
+
+    // consumer-owned
+    std::optional<uint64_t> peekedChunkEndPos_;
+    /// Number of samples already consumed from the chunk at `readPos_`
+    size_t readOffset_ = 0;
+
+    std::atomic<size_t> statsSize_ = 0;
+    std::atomic<size_t> statsPeakFill_ = 0;
+    std::atomic<uint32_t> statsSamplesPerSec_ = 0;
+    std::atomic<uint16_t> statsChannels_ = 0;
+    std::atomic<uint64_t> statsRefusedWrites_ = 0;
+    std::atomic<std::chrono::steady_clock::rep> statsTimeFull_ = 0;
+    std::atomic<uint64_t> statsUnderruns_ = 0;
+    std::atomic<uint32_t> stutterCount_ = 0;
 };
 
 template <typename Fn>
 bool sptf::AudioBuffer::read( Fn fn )
 {
-    std::lock_guard lock( posMutex_ );
-
-    size_t readPos = readPos_;
-    const size_t writePos = writePos_;
-    const size_t waterMark = waterMark_;
-
-    if ( readPos == writePos )
+    const auto chunkOpt = peek();
+    if ( !chunkOpt )
     {
         return false;
     }
 
-    readPos = ( readPos == waterMark ? 0 : readPos );
-
-    const auto curBufferPos = begin_ + readPos;
-    fn( *reinterpret_cast<AudioChunkHeader*>( curBufferPos ), curBufferPos + k_headerSizeInU16 );
-
-    readPos_ = readPos + k_headerSizeInU16 + reinterpret_cast<AudioChunkHeader*>( curBufferPos )->size;
+    fn( chunkOpt->header, chunkOpt->data.data() );
+    commit_read();
 
     return true;
 }
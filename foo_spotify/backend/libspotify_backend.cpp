@@ -3,6 +3,7 @@
 #include "libspotify_backend.h"
 
 #include <backend/libspotify_key.h>
+#include <backend/libspotify_wrapper.h>
 #include <backend/spotify_instance.h>
 #include <fb2k/advanced_config.h>
 #include <ui/ui_not_auth.h>
@@ -15,6 +16,7 @@
 #include <qwr/abort_callback.h>
 #include <qwr/error_popup.h>
 #include <qwr/fb2k_adv_config.h>
+#include <qwr/final_action.h>
 #include <qwr/thread_helpers.h>
 #include <qwr/winapi_error_helpers.h>
 
@@ -28,12 +30,24 @@ namespace fs = std::filesystem;
 
 using namespace sptf;
 
+namespace
+{
+
+constexpr auto kAudioBufferReleaseTimeout = std::chrono::seconds( 30 );
+// `metadata_updated` should always be emitted, but just in case
+constexpr auto kTrackLoadRecheckPeriod = std::chrono::seconds( 1 );
+constexpr auto kSlowCommandThreshold = std::chrono::milliseconds( 50 );
+
+} // namespace
+
 namespace sptf
 {
 
 LibSpotify_Backend::LibSpotify_Backend( AbortManager& abortManager )
     : abortManager_( abortManager )
-    , audioBuffer_( abortManager )
+    , shouldLogPlaybackDebug_( config::advanced::logging_playback_debug )
+    , shouldLogLibSpotifyDebug_( config::advanced::logging_libspotify_debug )
+    , audioBuffer_( abortManager, [&] { notify_main_thread(); } )
 {
     if ( const auto settingsPath = path::LibSpotifySettings(); !fs::exists( settingsPath ) )
     {
@@ -82,7 +96,7 @@ LibSpotify_Backend::LibSpotify_Backend( AbortManager& abortManager )
 
     SPTF_ASSIGN_CALLBACK( callbacks_, logged_in );
     SPTF_ASSIGN_DUMMY_CALLBACK( callbacks_, logged_out );
-    SPTF_ASSIGN_DUMMY_CALLBACK( callbacks_, metadata_updated );
+    SPTF_ASSIGN_CALLBACK( callbacks_, metadata_updated );
     SPTF_ASSIGN_DUMMY_CALLBACK( callbacks_, connection_error );
     SPTF_ASSIGN_CALLBACK( callbacks_, message_to_user );
     SPTF_ASSIGN_CALLBACK( callbacks_, notify_main_thread );
@@ -92,9 +106,9 @@ LibSpotify_Backend::LibSpotify_Backend( AbortManager& abortManager )
     SPTF_ASSIGN_CALLBACK( callbacks_, end_of_track );
     SPTF_ASSIGN_DUMMY_CALLBACK( callbacks_, streaming_error );
     SPTF_ASSIGN_DUMMY_CALLBACK( callbacks_, userinfo_updated );
-    SPTF_ASSIGN_DUMMY_CALLBACK( callbacks_, start_playback );
-    SPTF_ASSIGN_DUMMY_CALLBACK( callbacks_, stop_playback );
-    SPTF_ASSIGN_DUMMY_CALLBACK( callbacks_, get_audio_buffer_stats );
+    SPTF_ASSIGN_CALLBACK( callbacks_, start_playback );
+    SPTF_ASSIGN_CALLBACK( callbacks_, stop_playback );
+    SPTF_ASSIGN_CALLBACK( callbacks_, get_audio_buffer_stats );
     SPTF_ASSIGN_DUMMY_CALLBACK( callbacks_, offline_status_updated );
     SPTF_ASSIGN_DUMMY_CALLBACK( callbacks_, offline_error );
     SPTF_ASSIGN_DUMMY_CALLBACK( callbacks_, credentials_blob_updated );
@@ -138,6 +152,7 @@ void LibSpotify_Backend::Finalize()
 
     {
         std::lock_guard lock( apiMutex_ );
+        CancelPreloadNonBlocking();
         sp_session_player_unload( pSpSession_ );
         sp_session_release( pSpSession_ );
     }
@@ -182,6 +197,7 @@ sp_session* LibSpotify_Backend::GetWhateverSpSession()
 
 bool LibSpotify_Backend::Relogin( abort_callback& abort )
 {
+    bool shouldRelogin = true;
     {
         std::lock_guard lock( loginMutex_ );
 
@@ -190,19 +206,30 @@ bool LibSpotify_Backend::Relogin( abort_callback& abort )
             return false;
         }
 
-        if ( loginStatus_ == LoginStatus::uninitialized )
+        if ( loginStatus_ != LoginStatus::uninitialized )
+        {
+            shouldRelogin = false;
+        }
+        else
         {
             loginStatus_ = LoginStatus::login_in_process;
+        }
+    }
 
-            const auto spRet = [&] {
-                std::lock_guard lock( apiMutex_ );
-                return sp_session_relogin( pSpSession_ );
-            }();
-            if ( spRet == SP_ERROR_NO_CREDENTIALS )
+    if ( shouldRelogin )
+    {
+        // `loginMutex_` must not be held here: login callbacks are invoked in the event loop thread and lock it
+        const auto spRet = ExecSpMutex( [&] {
+            return sp_session_relogin( pSpSession_ );
+        } );
+        if ( spRet == SP_ERROR_NO_CREDENTIALS )
+        {
             {
+                std::lock_guard lock( loginMutex_ );
                 loginStatus_ = LoginStatus::logged_out;
-                return false;
             }
+            loginCv_.notify_all();
+            return false;
         }
     }
 
@@ -241,10 +268,9 @@ bool LibSpotify_Backend::LoginWithUI( HWND hWnd )
             return false;
         }
 
-        {
-            std::lock_guard lock( apiMutex_ );
+        ExecSpMutex( [&] {
             sp_session_login( pSpSession_, cpr->un.data(), cpr->pw.data(), true, nullptr );
-        }
+        } );
 
         qwr::TimedAbortCallback tac( fmt::format( "{}: {}", SPTF_UNDERSCORE_NAME, "LibSpotify wait for login update" ) );
         retStatus = WaitForLoginStatusUpdate( tac );
@@ -265,11 +291,10 @@ void LibSpotify_Backend::LogoutAndForget( abort_callback& abort )
         loginStatus_ = LoginStatus::logout_in_process;
     }
 
-    {
-        std::lock_guard lgApi( apiMutex_ );
+    ExecSpMutex( [&] {
         sp_session_logout( pSpSession_ );
         sp_session_forget_me( pSpSession_ );
-    }
+    } );
 
     WaitForLoginStatusUpdate( abort );
 }
@@ -284,24 +309,25 @@ std::string LibSpotify_Backend::GetLoggedInUserName()
         }
     }
 
-    std::lock_guard lock( apiMutex_ );
-
-    // `sp_user_display_name` always returns canonical name:
-    // https://stackoverflow.com/questions/23797162/sp-user-display-name-always-returns-canonical-name-even-when-user-is-loaded
+    return ExecSpMutex( [&]() -> std::string {
+        // `sp_user_display_name` always returns canonical name:
+        // https://stackoverflow.com/questions/23797162/sp-user-display-name-always-returns-canonical-name-even-when-user-is-loaded
 
-    const char* email = sp_session_user_name( pSpSession_ );
-    if ( !email )
-    {
-        return "<error: user name could not be fetched>";
-    }
+        const char* email = sp_session_user_name( pSpSession_ );
+        if ( !email )
+        {
+            return "<error: user name could not be fetched>";
+        }
 
-    return email;
+        return email;
+    } );
 }
 
 void LibSpotify_Backend::RefreshBitrate()
 {
-    std::lock_guard lock( apiMutex_ );
-    const auto sp = sp_session_preferred_bitrate( pSpSession_, static_cast<sp_bitrate>( static_cast<uint8_t>( config::preferred_bitrate.GetValue() ) ) );
+    const auto sp = ExecSpMutex( [&] {
+        return sp_session_preferred_bitrate( pSpSession_, static_cast<sp_bitrate>( static_cast<uint8_t>( config::preferred_bitrate.GetValue() ) ) );
+    } );
     if ( sp != SP_ERROR_OK )
     {
         qwr::ReportErrorWithPopup( SPTF_UNDERSCORE_NAME, fmt::format( "sp_session_preferred_bitrate failed:\n{}", sp_error_message( sp ) ) );
@@ -310,8 +336,9 @@ void LibSpotify_Backend::RefreshBitrate()
 
 void LibSpotify_Backend::RefreshNormalization()
 {
-    std::lock_guard lock( apiMutex_ );
-    const auto sp = sp_session_set_volume_normalization( pSpSession_, config::enable_normalization );
+    const auto sp = ExecSpMutex( [&] {
+        return sp_session_set_volume_normalization( pSpSession_, config::enable_normalization );
+    } );
     if ( sp != SP_ERROR_OK )
     {
         qwr::ReportErrorWithPopup( SPTF_UNDERSCORE_NAME, fmt::format( "sp_session_set_volume_normalization failed:\n{}", sp_error_message( sp ) ) );
@@ -328,10 +355,9 @@ void LibSpotify_Backend::RefreshPrivateMode()
         }
     }
 
-    {
-        std::lock_guard lock( apiMutex_ );
+    ExecSpMutex( [&] {
         RefreshPrivateModeNonBlocking();
-    }
+    } );
 }
 
 void LibSpotify_Backend::RefreshCacheSize()
@@ -373,8 +399,9 @@ void LibSpotify_Backend::RefreshCacheSize()
         }
     }();
 
-    std::lock_guard lock( apiMutex_ );
-    const auto sp = sp_session_set_cache_size( pSpSession_, cacheSize );
+    const auto sp = ExecSpMutex( [&] {
+        return sp_session_set_cache_size( pSpSession_, cacheSize );
+    } );
     if ( sp != SP_ERROR_OK )
     {
         qwr::ReportErrorWithPopup( SPTF_UNDERSCORE_NAME, fmt::format( "sp_session_set_cache_size failed:\n{}", sp_error_message( sp ) ) );
@@ -383,36 +410,109 @@ void LibSpotify_Backend::RefreshCacheSize()
 
 void LibSpotify_Backend::EventLoopThread()
 {
+    eventLoopThreadId_ = std::this_thread::get_id();
+
     int nextTimeout = INFINITE;
     while ( true )
     {
+        std::deque<Command> commands;
         {
+            auto waitTime = std::chrono::milliseconds( nextTimeout );
+            if ( const auto timeToReleaseOpt = GetTimeToAudioBufferRelease(); timeToReleaseOpt )
+            {
+                waitTime = std::min( waitTime, *timeToReleaseOpt );
+            }
+
             std::unique_lock lock( workerMutex_ );
 
-            while ( !hasEvents_ && !shouldStopEventLoop_ )
+            while ( !hasEvents_ && commands_.empty() && !shouldStopEventLoop_ )
             {
-                const auto ret = eventLoopCv_.wait_for( lock, std::chrono::milliseconds( nextTimeout ) );
+                const auto ret = eventLoopCv_.wait_for( lock, waitTime );
                 if ( std::cv_status::timeout == ret )
                 {
                     break;
                 }
             }
 
+            commands.swap( commands_ );
             if ( shouldStopEventLoop_ )
-            {
+            { // commands that were posted before stop must still be executed
+                lock.unlock();
+
+                std::lock_guard apiLock( apiMutex_ );
+                ExecuteCommands( commands );
                 return;
             }
             hasEvents_ = false;
         }
 
         std::lock_guard lock( apiMutex_ );
+
+        ReleaseIdleAudioBuffer();
+        ExecuteCommands( commands );
+
+        const auto startTime = std::chrono::steady_clock::now();
         sp_session_process_events( pSpSession_, &nextTimeout );
+        if ( shouldLogLibSpotifyDebug_ )
+        {
+            const auto execTime = std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now() - startTime );
+            if ( execTime >= kSlowCommandThreshold )
+            {
+                FB2K_console_formatter() << SPTF_UNDERSCORE_NAME " (debug):\n"
+                                         << fmt::format( "sp_session_process_events took {} ms", execTime.count() );
+            }
+        }
     }
 }
 
+void LibSpotify_Backend::ExecuteCommands( std::deque<Command>& commands )
+{
+    for ( auto& [command, postTime]: commands )
+    {
+        const auto startTime = std::chrono::steady_clock::now();
+        command();
+
+        if ( shouldLogLibSpotifyDebug_ )
+        {
+            const auto queueTime = std::chrono::duration_cast<std::chrono::milliseconds>( startTime - postTime );
+            const auto execTime = std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now() - startTime );
+            if ( queueTime >= kSlowCommandThreshold || execTime >= kSlowCommandThreshold )
+            {
+                FB2K_console_formatter() << SPTF_UNDERSCORE_NAME " (debug):\n"
+                                         << fmt::format( "libspotify command: waited for {} ms, executed in {} ms", queueTime.count(), execTime.count() );
+            }
+        }
+    }
+    commands.clear();
+}
+
+bool LibSpotify_Backend::IsEventLoopThread() const
+{
+    return ( std::this_thread::get_id() == eventLoopThreadId_.load() );
+}
+
+bool LibSpotify_Backend::TryPostCommand( std::function<void()> command )
+{
+    {
+        std::lock_guard lock( workerMutex_ );
+        if ( !isEventLoopRunning_ )
+        {
+            return false;
+        }
+        commands_.push_back( Command{ std::move( command ), std::chrono::steady_clock::now() } );
+    }
+
+    eventLoopCv_.notify_all();
+    return true;
+}
+
 void LibSpotify_Backend::StartEventLoopThread()
 {
     assert( !pWorker_ );
+    {
+        std::lock_guard lock( workerMutex_ );
+        isEventLoopRunning_ = true;
+    }
     pWorker_ = std::make_unique<std::thread>( &LibSpotify_Backend::EventLoopThread, this );
     qwr::SetThreadName( *pWorker_, "SPTF Event Loop" );
 }
@@ -427,6 +527,7 @@ void LibSpotify_Backend::StopEventLoopThread()
     {
         std::unique_lock<std::mutex> lock( workerMutex_ );
         shouldStopEventLoop_ = true;
+        isEventLoopRunning_ = false;
     }
     eventLoopCv_.notify_all();
 
@@ -437,9 +538,47 @@ void LibSpotify_Backend::StopEventLoopThread()
     pWorker_.reset();
 }
 
+std::optional<std::chrono::milliseconds> LibSpotify_Backend::GetTimeToAudioBufferRelease()
+{
+    std::lock_guard lk( decoderOwnerMutex_ );
+    if ( !audioBufferReleaseTime_ )
+    {
+        return std::nullopt;
+    }
+
+    const auto timeToRelease = std::chrono::duration_cast<std::chrono::milliseconds>( *audioBufferReleaseTime_ - std::chrono::steady_clock::now() );
+    return std::max( timeToRelease, std::chrono::milliseconds::zero() );
+}
+
+void LibSpotify_Backend::ReleaseIdleAudioBuffer()
+{
+    std::lock_guard lk( decoderOwnerMutex_ );
+    if ( pDecoderOwner_ || !audioBufferReleaseTime_ || std::chrono::steady_clock::now() < *audioBufferReleaseTime_ )
+    {
+        return;
+    }
+    audioBufferReleaseTime_.reset();
+
+    // player must be stopped, since it's the producer
+    UnloadTrack();
+    audioBuffer_.release();
+
+    if ( shouldLogPlaybackDebug_ )
+    {
+        FB2K_console_formatter() << SPTF_UNDERSCORE_NAME " (debug):\n"
+                                 << "audio buffer was released due to inactivity";
+    }
+}
+
 std::optional<bool> LibSpotify_Backend::WaitForLoginStatusUpdate( abort_callback& abort )
 {
-    const auto abortableScope = abortManager_.GetAbortableScope( [&] { loginCv_.notify_all(); }, abort );
+    const auto abortableScope = abortManager_.GetAbortableScope( [&] {
+        { // abort tasks are invoked only once, so the notification must not be lost
+            std::lock_guard lock( loginMutex_ );
+        }
+        loginCv_.notify_all();
+    },
+                                                                 abort );
 
     std::unique_lock lock( loginMutex_ );
 
@@ -465,6 +604,68 @@ void LibSpotify_Backend::RefreshPrivateModeNonBlocking()
     }
 }
 
+void LibSpotify_Backend::CancelPreloadNonBlocking()
+{
+    if ( pQueuedTrack_ )
+    {
+        sp_track_release( pQueuedTrack_ );
+        pQueuedTrack_ = nullptr;
+    }
+    queuedAfterTrackId_.clear();
+    queuedTrackId_.clear();
+    shouldPrefetchQueuedTrack_ = false;
+}
+
+void LibSpotify_Backend::PrefetchQueuedTrackNonBlocking()
+{
+    if ( !pQueuedTrack_ || prefetchedTrackId_ == queuedTrackId_ )
+    {
+        return;
+    }
+
+    const auto sp = sp_session_player_prefetch( pSpSession_, pQueuedTrack_ );
+    if ( sp != SP_ERROR_OK )
+    { // prefetch is optional: track will be fetched as usual when loaded
+        if ( shouldLogPlaybackDebug_ )
+        {
+            FB2K_console_formatter() << SPTF_UNDERSCORE_NAME " (debug):\n"
+                                     << fmt::format( "sp_session_player_prefetch failed: {}", sp_error_message( sp ) );
+        }
+        return;
+    }
+
+    prefetchedTrackId_ = queuedTrackId_;
+    if ( shouldLogPlaybackDebug_ )
+    {
+        FB2K_console_formatter() << SPTF_UNDERSCORE_NAME " (debug):\n"
+                                 << fmt::format( "prefetching next track: {}", queuedTrackId_ );
+    }
+}
+
+sp_error LibSpotify_Backend::PlayTrackNonBlocking( const std::string& trackId, sp_track* track, bool isPreload )
+{
+    // must be set before load, since music_delivery is called from another thread
+    shouldIgnoreFlush_ = isPreload;
+    // playback is (re)started explicitly
+    isPlaybackStopped_ = false;
+    isPlayingPreloadedTrack_ = false;
+    playerTrackId_.clear();
+    ++playerLoadId_;
+
+    const auto sp = sp_session_player_load( pSpSession_, track );
+    if ( sp != SP_ERROR_OK )
+    {
+        shouldIgnoreFlush_ = false;
+        return sp;
+    }
+
+    sp_session_player_play( pSpSession_, true );
+    playerTrackId_ = trackId;
+    isPlayingPreloadedTrack_ = isPreload;
+
+    return SP_ERROR_OK;
+}
+
 void LibSpotify_Backend::AcquireDecoder( void* owner )
 {
     std::lock_guard lk( decoderOwnerMutex_ );
@@ -474,15 +675,34 @@ void LibSpotify_Backend::AcquireDecoder( void* owner )
     }
 
     pDecoderOwner_ = owner;
+    audioBufferReleaseTime_.reset();
 }
 
 void LibSpotify_Backend::ReleaseDecoder( void* owner )
 {
     (void)owner;
 
-    std::lock_guard lk( decoderOwnerMutex_ );
-    assert( owner == pDecoderOwner_ );
-    pDecoderOwner_ = nullptr;
+    {
+        std::lock_guard lk( decoderOwnerMutex_ );
+        assert( owner == pDecoderOwner_ );
+        pDecoderOwner_ = nullptr;
+        audioBufferReleaseTime_ = std::chrono::steady_clock::now() + kAudioBufferReleaseTimeout;
+    }
+    // wake up event loop, so that it could pick up the new timeout
+    notify_main_thread();
+
+    if ( shouldLogPlaybackDebug_ )
+    {
+        const auto stats = audioBuffer_.get_stats();
+        FB2K_console_formatter() << SPTF_UNDERSCORE_NAME " (debug):\n"
+                                 << fmt::format( "audio buffer: size {} KiB ({} ms), peak fill {} ms, refused deliveries {}, time spent full {} ms, underruns {}",
+                                                 stats.sizeInBytes / 1024,
+                                                 stats.sizeInMs,
+                                                 stats.peakFillInMs,
+                                                 stats.refusedWrites,
+                                                 stats.timeFullInMs,
+                                                 stats.underruns );
+    }
 }
 
 AudioBuffer& LibSpotify_Backend::GetAudioBuffer()
@@ -490,6 +710,193 @@ AudioBuffer& LibSpotify_Backend::GetAudioBuffer()
     return audioBuffer_;
 }
 
+void LibSpotify_Backend::LoadTrack( const std::string& uri, wrapper::Ptr<sp_track>& track, abort_callback& abort )
+{
+    TrackLoadWaiter waiter{};
+
+    ExecSpMutex( [&] {
+        wrapper::Ptr<sp_link> link( sp_link_create_from_string( uri.c_str() ) );
+        if ( !link )
+        {
+            throw exception_io_data( "Couldn't parse url" );
+        }
+
+        track.Release();
+
+        switch ( sp_link_type( link ) )
+        {
+        case SP_LINKTYPE_TRACK:
+        {
+            track = sp_link_as_track( link );
+            break;
+        }
+        default:
+        {
+            throw exception_io_data( "Only track links should be passed to input" );
+        }
+        }
+
+        if ( const auto sp = sp_track_error( track ); sp != SP_ERROR_IS_LOADING )
+        {
+            waiter.result = sp;
+        }
+        else
+        { // registered in the event loop thread, so that `metadata_updated` can't be missed
+            waiter.pTrack = track;
+
+            std::lock_guard lock( trackLoadWaitersMutex_ );
+            trackLoadWaiters_.emplace_back( &waiter );
+        }
+    } );
+
+    const qwr::final_action autoRemoveWaiter( [&] {
+        std::lock_guard lock( trackLoadWaitersMutex_ );
+        trackLoadWaiters_.remove( &waiter );
+    } );
+
+    if ( !waiter.result )
+    {
+        const auto abortableScope = abortManager_.GetAbortableScope( [&] {
+            {
+                std::lock_guard lock( trackLoadWaitersMutex_ );
+            }
+            trackLoadWaitersCv_.notify_all();
+        },
+                                                                     abort );
+
+        while ( true )
+        {
+            {
+                std::unique_lock lock( trackLoadWaitersMutex_ );
+                trackLoadWaitersCv_.wait_for( lock, kTrackLoadRecheckPeriod, [&] {
+                    return ( waiter.result || abort.is_aborting() );
+                } );
+                if ( waiter.result )
+                {
+                    break;
+                }
+            }
+
+            abort.check();
+
+            const auto sp = ExecSpMutex( [&] { return sp_track_error( track ); } );
+            if ( sp != SP_ERROR_IS_LOADING )
+            {
+                std::lock_guard lock( trackLoadWaitersMutex_ );
+                waiter.result = sp;
+                break;
+            }
+        }
+    }
+
+    if ( *waiter.result != SP_ERROR_OK )
+    {
+        throw qwr::QwrException( fmt::format( "sp_track_error failed: {}", sp_error_message( *waiter.result ) ) );
+    }
+}
+
+sp_error LibSpotify_Backend::PlayTrack( const std::string& trackId, sp_track* track )
+{
+    return ExecSpMutex( [&] {
+        CancelPreloadNonBlocking();
+        return PlayTrackNonBlocking( trackId, track );
+    } );
+}
+
+sp_error LibSpotify_Backend::SeekTrack( const std::string& trackId, sp_track* track, int positionMs )
+{
+    return ExecSpMutex( [&] {
+        if ( playerTrackId_ != trackId || isPlayingPreloadedTrack_ )
+        { // player has already moved on to the preloaded track
+            const auto sp = PlayTrackNonBlocking( trackId, track );
+            if ( sp != SP_ERROR_OK )
+            {
+                return sp;
+            }
+        }
+
+        return sp_session_player_seek( pSpSession_, positionMs );
+    } );
+}
+
+void LibSpotify_Backend::UnloadTrack()
+{
+    ExecSpMutex( [&] {
+        CancelPreloadNonBlocking();
+        sp_session_player_unload( pSpSession_ );
+        playerTrackId_.clear();
+        isPlayingPreloadedTrack_ = false;
+        shouldIgnoreFlush_ = false;
+    } );
+}
+
+void LibSpotify_Backend::QueueNextTrack( const std::string& afterTrackId, const std::string& trackId, sp_track* track, abort_callback& abort )
+{
+    assert( track );
+
+    ExecSpMutex( [&] {
+        if ( abort.is_aborting() )
+        { // preload was canceled (and possibly replaced with a newer one)
+            return;
+        }
+
+        // prefetch point depends only on the current track
+        const bool shouldPrefetch = shouldPrefetchQueuedTrack_;
+        CancelPreloadNonBlocking();
+
+        sp_track_add_ref( track );
+        pQueuedTrack_ = track;
+        queuedAfterTrackId_ = afterTrackId;
+        queuedTrackId_ = trackId;
+
+        shouldPrefetchQueuedTrack_ = shouldPrefetch;
+        if ( shouldPrefetch )
+        {
+            PrefetchQueuedTrackNonBlocking();
+        }
+    } );
+}
+
+void LibSpotify_Backend::CancelPreload()
+{
+    ExecSpMutex( [&] {
+        CancelPreloadNonBlocking();
+    } );
+}
+
+void LibSpotify_Backend::PrefetchQueuedTrack()
+{
+    // no need to wait for the result
+    ExecSpAsync( [this] {
+        shouldPrefetchQueuedTrack_ = true;
+        PrefetchQueuedTrackNonBlocking();
+    } );
+}
+
+bool LibSpotify_Backend::AdoptPreloadedTrack( const std::string& trackId )
+{
+    return ExecSpMutex( [&] {
+        if ( !isPlayingPreloadedTrack_ || playerTrackId_ != trackId )
+        {
+            return false;
+        }
+        if ( audioBuffer_.get_read_pos() < preloadStartPos_ )
+        { // previous track was not played to the end (e.g. skipped while its tail was still in the buffer)
+            return false;
+        }
+
+        isPlayingPreloadedTrack_ = false;
+        return true;
+    } );
+}
+
+bool LibSpotify_Backend::WasTrackPrefetched( const std::string& trackId )
+{
+    return ExecSpMutex( [&] {
+        return ( prefetchedTrackId_ == trackId );
+    } );
+}
+
 void LibSpotify_Backend::log_message( const char* error )
 {
     FB2K_console_formatter() << SPTF_UNDERSCORE_NAME " (log): " << error;
@@ -521,6 +928,33 @@ void LibSpotify_Backend::logged_in( sp_error error )
     }
 }
 
+void LibSpotify_Backend::metadata_updated()
+{
+    // called from `sp_session_process_events` in the event loop thread
+    bool hasUpdates = false;
+    {
+        std::lock_guard lock( trackLoadWaitersMutex_ );
+        for ( auto pWaiter: trackLoadWaiters_ )
+        {
+            if ( pWaiter->result )
+            {
+                continue;
+            }
+
+            if ( const auto sp = sp_track_error( pWaiter->pTrack ); sp != SP_ERROR_IS_LOADING )
+            {
+                pWaiter->result = sp;
+                hasUpdates = true;
+            }
+        }
+    }
+
+    if ( hasUpdates )
+    {
+        trackLoadWaitersCv_.notify_all();
+    }
+}
+
 void LibSpotify_Backend::message_to_user( const char* message )
 {
     qwr::ReportErrorWithPopup( SPTF_NAME, message );
@@ -540,7 +974,18 @@ int LibSpotify_Backend::music_delivery( const sp_audioformat* format, const void
 {
     if ( !num_frames )
     {
-        audioBuffer_.clear();
+        if ( !shouldIgnoreFlush_ )
+        {
+            audioBuffer_.flush();
+        }
+        return 0;
+    }
+    if ( shouldIgnoreFlush_ )
+    {
+        shouldIgnoreFlush_ = false;
+    }
+    if ( isPlaybackStopped_ )
+    { // libspotify will retry after `start_playback`
         return 0;
     }
 
@@ -556,16 +1001,70 @@ int LibSpotify_Backend::music_delivery( const sp_audioformat* format, const void
                                                              (uint16_t)format->channels,
                                                              ( uint16_t )( num_frames * format->channels ) },
                               static_cast<const uint16_t*>( frames ) ) )
-    {
+    { // buffer is full: libspotify will retry after `notify_main_thread` is called from drain callback
         return 0;
     }
 
     return num_frames;
 }
 
+void LibSpotify_Backend::start_playback()
+{
+    isPlaybackStopped_ = false;
+    if ( shouldLogPlaybackDebug_ )
+    {
+        FB2K_console_formatter() << SPTF_UNDERSCORE_NAME " (debug):\n"
+                                 << "libspotify: playback started";
+    }
+
+    // wake up event loop, so that libspotify could retry the delivery
+    notify_main_thread();
+}
+
+void LibSpotify_Backend::stop_playback()
+{
+    isPlaybackStopped_ = true;
+    if ( shouldLogPlaybackDebug_ )
+    {
+        FB2K_console_formatter() << SPTF_UNDERSCORE_NAME " (debug):\n"
+                                 << "libspotify: playback stopped";
+    }
+}
+
+void LibSpotify_Backend::get_audio_buffer_stats( sp_audio_buffer_stats* stats )
+{ // used by libspotify to pace the delivery
+    stats->samples = static_cast<int>( audioBuffer_.get_buffered_frames() );
+    stats->stutter = static_cast<int>( audioBuffer_.take_stutter_count() );
+}
+
 void LibSpotify_Backend::end_of_track()
 {
-    audioBuffer_.write_end();
+    // called from the libspotify audio thread (same as `music_delivery`), which is the only producer
+    const auto eofEndPos = audioBuffer_.write_end();
+    const auto playerLoadId = playerLoadId_.load();
+
+    // player state is owned by the event loop thread
+    (void)TryPostCommand( [this, eofEndPos, playerLoadId] {
+        if ( playerLoadId != playerLoadId_ )
+        { // player was reloaded after the track has ended (e.g. seek or another track)
+            return;
+        }
+        if ( !pQueuedTrack_ || queuedAfterTrackId_ != playerTrackId_ )
+        {
+            CancelPreloadNonBlocking();
+            return;
+        }
+
+        // start the next track right away: its data will be placed after the eof marker of the current one
+        const auto trackId = queuedTrackId_;
+        wrapper::Ptr<sp_track> track( pQueuedTrack_ );
+        CancelPreloadNonBlocking();
+
+        // errors will be reported by decoder of the next track, since it won't be able to adopt it
+        preloadStartPos_ = eofEndPos;
+        (void)PlayTrackNonBlocking( trackId, track, true );
+        track.Release();
+    } );
 }
 
 void LibSpotify_Backend::play_token_lost()
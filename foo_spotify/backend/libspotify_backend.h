@@ -6,10 +6,27 @@
 
 #include <libspotify/api.h>
 
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <list>
 #include <optional>
+#include <string>
+#include <thread>
+#include <type_traits>
 #include <unordered_set>
 
+namespace sptf::wrapper
+{
+
+template <typename T>
+class Ptr;
+
+}
+
 namespace sptf
 {
 
@@ -33,14 +50,64 @@ public:
 
     AudioBuffer& GetAudioBuffer();
 
+    /// @throw qwr::QwrException
+    /// @throw exception_io_data
+    /// @throw exception_aborted
+    void LoadTrack( const std::string& uri, wrapper::Ptr<sp_track>& track, abort_callback& abort );
+
+    /// Loads the track into player and starts playing it.
+    /// Cancels pending preload.
+    sp_error PlayTrack( const std::string& trackId, sp_track* track );
+    /// Reloads the track if player has already switched to the preloaded one.
+    sp_error SeekTrack( const std::string& trackId, sp_track* track, int positionMs );
+    void UnloadTrack();
+
+    /// Track will be loaded into player as soon as the playback of `afterTrackId` has ended,
+    /// so that its data follows the current track in the audio buffer without a gap.
+    /// Does nothing if `abort` is signaled: the check is atomic with queueing,
+    /// so that a stale request can't override the newer one.
+    void QueueNextTrack( const std::string& afterTrackId, const std::string& trackId, sp_track* track, abort_callback& abort );
+    void CancelPreload();
+    /// Warms up libspotify cache for the queued track.
+    /// If the track is not queued yet, it will be prefetched as soon as it is.
+    /// Does not wait for the result.
+    void PrefetchQueuedTrack();
+    /// @return true, if player has already switched to the track via preload
+    /// and the previous track was consumed up to its eof marker
+    bool AdoptPreloadedTrack( const std::string& trackId );
+    /// @return true, if the track was the last one prefetched
+    bool WasTrackPrefetched( const std::string& trackId );
+
     sp_session* GetInitializedSpSession( abort_callback& abort );
     sp_session* GetWhateverSpSession();
 
+    /// Posts the call to the event loop thread, where all libspotify calls are executed in order.
+    /// The call is executed in-place if invoked from the event loop thread or if the loop is not running.
+    template <typename Fn>
+    auto ExecSpAsync( Fn func ) -> std::future<std::invoke_result_t<Fn>>
+    {
+        using ResultT = std::invoke_result_t<Fn>;
+
+        auto pTask = std::make_shared<std::packaged_task<ResultT()>>( std::move( func ) );
+        auto future = pTask->get_future();
+        if ( IsEventLoopThread() )
+        { // `apiMutex_` is already locked by the event loop
+            ( *pTask )();
+        }
+        else if ( !TryPostCommand( [pTask] { ( *pTask )(); } ) )
+        {
+            std::lock_guard lock( apiMutex_ );
+            ( *pTask )();
+        }
+
+        return future;
+    }
+
+    /// Same as `ExecSpAsync`, but waits for the result.
     template <typename Fn, typename... Args>
     auto ExecSpMutex( Fn func, Args&&... args ) -> decltype( auto )
     {
-        std::lock_guard lock( apiMutex_ );
-        return func( std::forward<Args>( args )... );
+        return ExecSpAsync( [&] { return func( std::forward<Args>( args )... ); } ).get();
     }
 
     bool Relogin( abort_callback& abort );
@@ -59,17 +126,39 @@ private:
     void StartEventLoopThread();
     void StopEventLoopThread();
 
+    struct Command
+    {
+        std::function<void()> func;
+        std::chrono::steady_clock::time_point postTime;
+    };
+
+    bool IsEventLoopThread() const;
+    /// @return false, if event loop is not running
+    bool TryPostCommand( std::function<void()> command );
+    void ExecuteCommands( std::deque<Command>& commands );
+
+    /// @return time to wait for until buffer is released, if release is pending
+    std::optional<std::chrono::milliseconds> GetTimeToAudioBufferRelease();
+    void ReleaseIdleAudioBuffer();
+
     std::optional<bool> WaitForLoginStatusUpdate( abort_callback& abort );
 
     void RefreshPrivateModeNonBlocking();
+    void CancelPreloadNonBlocking();
+    void PrefetchQueuedTrackNonBlocking();
+    sp_error PlayTrackNonBlocking( const std::string& trackId, sp_track* track, bool isPreload = false );
 
     // callbacks
 
     void log_message( const char* error );
     void logged_in( sp_error error );
+    void metadata_updated();
     void message_to_user( const char* error );
     void notify_main_thread();
     int music_delivery( const sp_audioformat* format, const void* frames, int num_frames );
+    void start_playback();
+    void stop_playback();
+    void get_audio_buffer_stats( sp_audio_buffer_stats* stats );
     void end_of_track();
     void play_token_lost();
     void connectionstate_updated();
@@ -78,20 +167,56 @@ private:
 private:
     AbortManager& abortManager_;
 
+    const bool shouldLogPlaybackDebug_;
+    const bool shouldLogLibSpotifyDebug_;
+
     sp_session_callbacks callbacks_{};
     sp_session_config config_{};
 
     std::mutex decoderOwnerMutex_;
     void* pDecoderOwner_ = nullptr;
+    std::optional<std::chrono::steady_clock::time_point> audioBufferReleaseTime_;
 
+    /// All libspotify calls are made from the event loop thread (see `ExecSpAsync`):
+    /// mutex is only needed for calls made when the loop is not running.
     std::mutex apiMutex_;
     sp_session* pSpSession_ = nullptr;
 
+    // accessed only from the event loop thread
+    std::string playerTrackId_;
+    bool isPlayingPreloadedTrack_ = false;
+    /// Audio buffer position, where the data of the preloaded track begins
+    uint64_t preloadStartPos_ = 0;
+    std::string queuedAfterTrackId_;
+    std::string queuedTrackId_;
+    sp_track* pQueuedTrack_ = nullptr;
+    bool shouldPrefetchQueuedTrack_ = false;
+    std::string prefetchedTrackId_;
+    /// libspotify might request a flush on track load, which would discard the tail of the previous track
+    std::atomic_bool shouldIgnoreFlush_ = false;
+    /// Set by libspotify: deliveries are refused until playback is started again
+    std::atomic_bool isPlaybackStopped_ = false;
+    /// Incremented on each player load: used to detect stale end-of-track notifications
+    std::atomic<uint64_t> playerLoadId_ = 0;
+
     std::unique_ptr<std::thread> pWorker_;
     std::mutex workerMutex_;
     std::condition_variable eventLoopCv_;
     bool hasEvents_ = false;
     bool shouldStopEventLoop_ = false;
+    bool isEventLoopRunning_ = false;
+    std::deque<Command> commands_;
+    std::atomic<std::thread::id> eventLoopThreadId_ = std::thread::id{};
+
+    struct TrackLoadWaiter
+    {
+        sp_track* pTrack;
+        std::optional<sp_error> result;
+    };
+
+    std::mutex trackLoadWaitersMutex_;
+    std::condition_variable trackLoadWaitersCv_;
+    std::list<TrackLoadWaiter*> trackLoadWaiters_;
 
     std::mutex backendUsersMutex_;
     std::unordered_set<LibSpotify_BackendUser*> backendUsers_;
@@ -22,7 +22,10 @@
 #include <qwr/file_helpers.h>
 #include <qwr/final_action.h>
 #include <qwr/string_helpers.h>
+#include <qwr/thread_helpers.h>
 
+#include <algorithm>
+#include <optional>
 #include <random>
 #include <string_view>
 #include <unordered_set>
@@ -47,6 +50,17 @@ namespace
 
 constexpr wchar_t k_clientId[] = L"30826243a65f43f19b038fd65ffaa8b5";
 
+/// Token is renewed in-place, if it expires sooner than that
+constexpr auto kMinTimeToExpiry = std::chrono::seconds( 60 );
+/// Background renewal starts this long before expiration (plus jitter)
+constexpr auto kRefreshLead = std::chrono::seconds( 300 );
+/// Spreads out renewals, so that they don't happen at the same time across instances
+constexpr auto kMaxRefreshJitter = std::chrono::seconds( 120 );
+/// Delay before the next background attempt, if the renewal failed
+constexpr auto kRefreshRetryPeriod = std::chrono::seconds( 30 );
+/// Lower bound for the delay before the next background renewal
+constexpr auto kMinRefreshDelay = std::chrono::seconds( 30 );
+
 } // namespace
 
 namespace
@@ -181,6 +195,12 @@ struct AuthData
     WebApiAuthScopes scopes;
 };
 
+struct AccessToken
+{
+    std::wstring token;
+    std::chrono::time_point<std::chrono::system_clock> expiresAt;
+};
+
 void to_json( nlohmann::json& j, const AuthData& p )
 {
     j["access_token"] = p.accessToken;
@@ -232,11 +252,15 @@ WebApiAuthorizer::WebApiAuthorizer( const web::http::client::http_client_config&
             }
         }
     }
+
+    PublishAccessToken_NonBlocking();
+    StartRefresher();
 }
 
 WebApiAuthorizer::~WebApiAuthorizer()
 {
     cts_.cancel();
+    StopRefresher();
     StopResponseListener();
 }
 
@@ -248,6 +272,14 @@ bool WebApiAuthorizer::HasRefreshToken() const
 
 const std::wstring WebApiAuthorizer::GetAccessToken( abort_callback& abort )
 {
+    if ( const auto pToken = std::atomic_load( &pAccessToken_ );
+         pToken && std::chrono::system_clock::now() + kMinTimeToExpiry < pToken->expiresAt )
+    { // fast path: background refresher keeps the token fresh
+        assert( !pToken->token.empty() );
+        return pToken->token;
+    }
+
+    // fallback: background refresher has failed or has not finished yet
     std::lock_guard lock( accessTokenMutex_ );
 
     if ( !pAuthData_ )
@@ -259,15 +291,22 @@ const std::wstring WebApiAuthorizer::GetAccessToken( abort_callback& abort )
         throw qwr::QwrException( "Failed to get authenticated Spotify session" );
     }
 
-    UpdateRefreshToken_NonBlocking( abort );
+    UpdateRefreshToken_NonBlocking( abort, kMinTimeToExpiry );
 
     assert( !pAuthData_->accessToken.empty() );
     return pAuthData_->accessToken;
 }
 
 void WebApiAuthorizer::ClearAuth()
+{
+    std::lock_guard lock( accessTokenMutex_ );
+    ClearAuth_NonBlocking();
+}
+
+void WebApiAuthorizer::ClearAuth_NonBlocking()
 {
     pAuthData_.reset();
+    PublishAccessToken_NonBlocking();
     codeVerifier_.clear();
     state_.clear();
 
@@ -321,14 +360,14 @@ void WebApiAuthorizer::AuthenticateClean_Cleanup()
 void WebApiAuthorizer::UpdateRefreshToken( abort_callback& abort )
 {
     std::lock_guard lock( accessTokenMutex_ );
-    UpdateRefreshToken_NonBlocking( abort );
+    UpdateRefreshToken_NonBlocking( abort, kMinTimeToExpiry );
 }
 
-void WebApiAuthorizer::UpdateRefreshToken_NonBlocking( abort_callback& abort )
+void WebApiAuthorizer::UpdateRefreshToken_NonBlocking( abort_callback& abort, std::chrono::seconds minTimeToExpiry )
 {
     assert( pAuthData_ );
 
-    if ( std::chrono::system_clock::now() + std::chrono::minutes( 1 ) < pAuthData_->expiresAt )
+    if ( std::chrono::system_clock::now() + minTimeToExpiry < pAuthData_->expiresAt )
     {
         return;
     }
@@ -347,8 +386,125 @@ void WebApiAuthorizer::UpdateRefreshToken_NonBlocking( abort_callback& abort )
     auto localCts = Concurrency::cancellation_token_source::create_linked_source( ctsToken );
     const auto abortableScope = abortManager_.GetAbortableScope( [&localCts] { localCts.cancel(); }, abort );
 
-    auto response = client_.request( req, cts_.get_token() );
-    HandleAuthenticationResponse( response.get() );
+    auto response = client_.request( req, localCts.get_token() );
+    HandleAuthenticationResponse_NonBlocking( response.get() );
+}
+
+void WebApiAuthorizer::PublishAccessToken_NonBlocking()
+{
+    std::shared_ptr<const AccessToken> pToken;
+    if ( pAuthData_ )
+    {
+        pToken = std::make_shared<const AccessToken>( AccessToken{ pAuthData_->accessToken, pAuthData_->expiresAt } );
+    }
+    std::atomic_store( &pAccessToken_, pToken );
+
+    {
+        std::lock_guard lock( refresherMutex_ );
+        hasAuthChanged_ = true;
+    }
+    refresherCv_.notify_all();
+}
+
+void WebApiAuthorizer::StartRefresher()
+{
+    pRefresher_ = std::make_unique<std::thread>( &WebApiAuthorizer::RefresherLoop, this );
+    qwr::SetThreadName( *pRefresher_, "SPTF Web API Token Refresher" );
+}
+
+void WebApiAuthorizer::StopRefresher()
+{
+    if ( !pRefresher_ )
+    {
+        return;
+    }
+
+    {
+        std::lock_guard lock( refresherMutex_ );
+        shouldStopRefresher_ = true;
+    }
+    refresherCv_.notify_all();
+    refresherAbort_.abort();
+
+    if ( pRefresher_->joinable() )
+    {
+        pRefresher_->join();
+    }
+
+    pRefresher_.reset();
+}
+
+void WebApiAuthorizer::RefresherLoop()
+{
+    std::mt19937 rng( std::random_device{}() );
+    std::uniform_int_distribution<int> jitterDist( 0, static_cast<int>( kMaxRefreshJitter.count() ) );
+
+    const auto waitFor = [&]( std::optional<std::chrono::system_clock::time_point> timeOpt ) {
+        std::unique_lock lock( refresherMutex_ );
+        const auto isWoken = [&] { return shouldStopRefresher_ || hasAuthChanged_; };
+        if ( timeOpt )
+        {
+            refresherCv_.wait_until( lock, *timeOpt, isWoken );
+        }
+        else
+        {
+            refresherCv_.wait( lock, isWoken );
+        }
+        hasAuthChanged_ = false;
+        return !shouldStopRefresher_;
+    };
+
+    // renewal is always scheduled from the latest token, so changes just reschedule it
+    std::optional<std::chrono::system_clock::time_point> nextRefreshTimeOpt;
+    while ( true )
+    {
+        if ( const auto pToken = std::atomic_load( &pAccessToken_ ); pToken )
+        {
+            // tokens that live shorter than the refresh lead would be renewed in a tight loop otherwise
+            const auto now = std::chrono::system_clock::now();
+            const auto minRefreshTime = now + std::max<std::chrono::system_clock::duration>( ( pToken->expiresAt - now ) / 2, kMinRefreshDelay );
+            nextRefreshTimeOpt = std::max( pToken->expiresAt - kRefreshLead - std::chrono::seconds( jitterDist( rng ) ), minRefreshTime );
+        }
+        else
+        { // nothing to refresh until authenticated
+            nextRefreshTimeOpt.reset();
+        }
+
+        if ( !waitFor( nextRefreshTimeOpt ) )
+        {
+            return;
+        }
+        if ( !nextRefreshTimeOpt || std::chrono::system_clock::now() < *nextRefreshTimeOpt )
+        { // woken up by the token change
+            continue;
+        }
+
+        try
+        {
+            std::lock_guard lock( accessTokenMutex_ );
+            if ( pAuthData_ )
+            {
+                UpdateRefreshToken_NonBlocking( refresherAbort_, kRefreshLead + kMaxRefreshJitter );
+            }
+        }
+        catch ( const std::exception& e )
+        {
+            if ( refresherAbort_.is_aborting() )
+            {
+                return;
+            }
+
+            FB2K_console_formatter() << SPTF_UNDERSCORE_NAME " (error):\n"
+                                     << fmt::format( "Failed to refresh Web API access token in background: {}\n"
+                                                     "Retrying in {} s",
+                                                     e.what(),
+                                                     kRefreshRetryPeriod.count() );
+            if ( !waitFor( std::chrono::system_clock::now() + kRefreshRetryPeriod ) )
+            {
+                return;
+            }
+        }
+    }
 }
 
 pplx::task<void> WebApiAuthorizer::CompleteAuthentication( const std::wstring& responseUrl )
@@ -384,7 +540,9 @@ pplx::task<void> WebApiAuthorizer::CompleteAuthentication( const std::wstring& r
     req.set_body( builder.query() );
 
     const auto response = co_await client_.request( req, cts_.get_token() );
-    HandleAuthenticationResponse( response );
+
+    std::lock_guard lock( accessTokenMutex_ );
+    HandleAuthenticationResponse_NonBlocking( response );
 }
 
 void WebApiAuthorizer::StartResponseListener( std::function<void()> onResponseEnd )
@@ -418,7 +576,11 @@ void WebApiAuthorizer::StartResponseListener( std::function<void()> onResponseEn
                 }
                 catch ( const std::exception& e )
                 {
-                    pAuthData_.reset();
+                    {
+                        std::lock_guard lock( accessTokenMutex_ );
+                        pAuthData_.reset();
+                        PublishAccessToken_NonBlocking();
+                    }
                     auto errorMsg = qwr::unicode::ToWide( std::string( e.what() ) );
                     {
                         size_t pos = 0;
@@ -472,11 +634,11 @@ void WebApiAuthorizer::StopResponseListener()
     }
 }
 
-void WebApiAuthorizer::HandleAuthenticationResponse( const web::http::http_response& response )
+void WebApiAuthorizer::HandleAuthenticationResponse_NonBlocking( const web::http::http_response& response )
 {
     if ( response.status_code() != 200 )
     {
-        ClearAuth();
+        ClearAuth_NonBlocking();
 
         throw qwr::QwrException( L"{}: {}\n"
                                  L"Additional data: {}\n",
@@ -520,6 +682,7 @@ void WebApiAuthorizer::HandleAuthenticationResponse( const web::http::http_respo
     qwr::file::WriteFile( settingsPath / "auth.json", nlohmann::json( pAuthData ).dump( 2 ) );
 
     pAuthData_ = std::move( pAuthData );
+    PublishAccessToken_NonBlocking();
 }
 
 } // namespace sptf
@@ -5,6 +5,10 @@
 #include <cpprest/http_msg.h>
 
 #include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 namespace web::http::experimental::listener
 {
@@ -17,6 +21,7 @@ namespace sptf
 class AbortManager;
 struct WebApiAuthScopes;
 struct AuthData;
+struct AccessToken;
 
 class WebApiAuthorizer
 {
@@ -26,6 +31,8 @@ public:
 
     bool HasRefreshToken() const;
 
+    /// Lock-free, unless the token is about to expire:
+    /// it is normally renewed in background, before it expires.
     const std::wstring GetAccessToken( abort_callback& abort );
 
     void ClearAuth();
@@ -36,12 +43,21 @@ public:
     void UpdateRefreshToken( abort_callback& abort );
 
 private:
-    void UpdateRefreshToken_NonBlocking( abort_callback& abort );
+    /// @param minTimeToExpiry token is not renewed, if it expires later than that
+    void UpdateRefreshToken_NonBlocking( abort_callback& abort, std::chrono::seconds minTimeToExpiry );
+    void ClearAuth_NonBlocking();
+    /// Must be called after each change of `pAuthData_`.
+    void PublishAccessToken_NonBlocking();
+
+    void StartRefresher();
+    void StopRefresher();
+    void RefresherLoop();
+
     pplx::task<void> CompleteAuthentication( const std::wstring& respondUrl );
 
     void StartResponseListener( std::function<void()> onResponseEnd );
     void StopResponseListener();
-    void HandleAuthenticationResponse( const web::http::http_response& response );
+    void HandleAuthenticationResponse_NonBlocking( const web::http::http_response& response );
 
 private:
     AbortManager& abortManager_;
@@ -53,8 +69,18 @@ private:
     std::wstring codeVerifier_;
     std::wstring state_;
 
+    /// Guards `pAuthData_`: it's also accessed from the background refresher
     mutable std::mutex accessTokenMutex_;
     std::unique_ptr<AuthData> pAuthData_;
+    /// Snapshot of `pAuthData_`: accessed only via `std::atomic_load` and `std::atomic_store`
+    std::shared_ptr<const AccessToken> pAccessToken_;
+
+    std::unique_ptr<std::thread> pRefresher_;
+    std::mutex refresherMutex_;
+    std::condition_variable refresherCv_;
+    bool shouldStopRefresher_ = false;
+    bool hasAuthChanged_ = false;
+    abort_callback_impl refresherAbort_;
 };
 
 } // namespace sptf
\ No newline at end of file
@@ -8,29 +8,47 @@
 #include <backend/webapi_objects/webapi_user.h>
 #include <fb2k/advanced_config.h>
 #include <utils/abort_manager.h>
+#include <utils/async_helpers.h>
 #include <utils/json_std_extenders.h>
-#include <utils/sleeper.h>
 
 #include <component_urls.h>
+#include <pplawait.h>
 
 #include <qwr/fb2k_adv_config.h>
 #include <qwr/file_helpers.h>
-#include <qwr/final_action.h>
 #include <qwr/string_helpers.h>
 #include <qwr/type_traits.h>
 #include <qwr/winapi_error_helpers.h>
 
+#include <deque>
+#include <experimental/resumable>
 #include <filesystem>
 #include <unordered_set>
 
-// TODO: replace unique_ptr with shared_ptr wherever needed to avoid copying
-
 namespace fs = std::filesystem;
 
 namespace
 {
 
-constexpr size_t kRpsLimit = 2;
+constexpr double kMaxRps = 2;
+constexpr size_t kRpsBurst = 5;
+
+constexpr size_t kMaxIdsPerRequest = 50;
+// single-object requests made within this window are sent as one batched request
+constexpr auto kBatchWindow = std::chrono::milliseconds( 20 );
+
+/// Skips fields that are not used by any of Web API objects while parsing:
+/// `available_markets` alone takes up most of the track and album data.
+bool FilterUnusedFields( int /*depth*/, nlohmann::json::parse_event_t event, nlohmann::json& parsed )
+{
+    if ( event != nlohmann::json::parse_event_t::key )
+    {
+        return true;
+    }
+
+    const auto& key = parsed.get_ref<const std::string&>();
+    return ( key != "available_markets" && key != "external_urls" && key != "external_ids" );
+}
 
 }
 
@@ -41,10 +59,15 @@ WebApi_Backend::WebApi_Backend( AbortManager& abortManager )
     : abortManager_( abortManager )
     , shouldLogWebApiRequest_( config::advanced::logging_webapi_request )
     , shouldLogWebApiResponse_( config::advanced::logging_webapi_response )
-    , rpsLimiter_( kRpsLimit )
+    , shouldLogWebApiDebug_( config::advanced::logging_webapi_debug )
+    , rpsLimiter_( kMaxRps, kRpsBurst )
     , client_( url::spotifyApi, GetClientConfig() )
-    , trackCache_( "tracks" )
-    , artistCache_( "artists" )
+    , trackCache_( config::advanced::cache_memory_object_count.GetValue(), config::advanced::cache_use_packed_store )
+    , artistCache_( "artists", config::advanced::cache_memory_object_count.GetValue(), config::advanced::cache_use_packed_store )
+    , trackRequests_( abortManager )
+    , artistRequests_( abortManager )
+    , trackBatcher_( abortManager, kMaxIdsPerRequest, kBatchWindow, [this]( auto ids, auto& abort ) { return FetchTracksAsync( std::move( ids ), abort ); } )
+    , artistBatcher_( abortManager, kMaxIdsPerRequest, kBatchWindow, [this]( auto ids, auto& abort ) { return FetchArtistsAsync( std::move( ids ), abort ); } )
     , albumImageCache_( "albums" )
     , artistImageCache_( "artists" )
     , pAuth_( std::make_unique<WebApiAuthorizer>( GetClientConfig(), abortManager ) )
@@ -57,6 +80,28 @@ WebApi_Backend::~WebApi_Backend()
 
 void WebApi_Backend::Finalize()
 {
+    if ( shouldLogWebApiDebug_ )
+    {
+        const auto logStats = []( const std::string& name, const auto& stats ) {
+            FB2K_console_formatter() << SPTF_UNDERSCORE_NAME " (debug):\n"
+                                     << fmt::format( "{} cache: {} objects in memory, {} hits, {} misses",
+                                                     name,
+                                                     stats.size,
+                                                     stats.hits,
+                                                     stats.misses );
+        };
+        logStats( "track", trackCache_.GetStats() );
+        logStats( "album", trackCache_.GetAlbumStats() );
+        logStats( "artist", artistCache_.GetStats() );
+
+        const auto rpsMetrics = rpsLimiter_.GetMetrics();
+        FB2K_console_formatter() << SPTF_UNDERSCORE_NAME " (debug):\n"
+                                 << fmt::format( "rate limiter: {:.2f} rps, throttled for {} ms in total, {} rate limit errors",
+                                                 rpsMetrics.currentRps,
+                                                 rpsMetrics.throttleTime.count(),
+                                                 rpsMetrics.rateLimitErrors );
+    }
+
     cts_.cancel();
     pAuth_.reset();
 }
@@ -66,125 +111,149 @@ WebApiAuthorizer& WebApi_Backend::GetAuthorizer()
     return *pAuth_;
 }
 
-std::unique_ptr<const sptf::WebApi_User> WebApi_Backend::GetUser( abort_callback& abort )
+std::shared_ptr<const WebApi_User> WebApi_Backend::GetUser( abort_callback& abort )
+{
+    return GetUserAsync( abort ).get();
+}
+
+pplx::task<std::shared_ptr<const WebApi_User>> WebApi_Backend::GetUserAsync( abort_callback& abort )
 {
     if ( auto userOpt = userCache_.GetObjectFromCache();
          userOpt )
     {
-        return std::unique_ptr<sptf::WebApi_User>( std::move( *userOpt ) );
+        co_return std::shared_ptr<const WebApi_User>( std::move( *userOpt ) );
     }
-    else
-    {
-        web::uri_builder builder;
-        builder.append_path( L"me" );
 
-        const auto responseJson = GetJsonResponse( builder.to_uri(), abort );
-        auto ret = responseJson.get<std::unique_ptr<WebApi_User>>();
+    web::uri_builder builder;
+    builder.append_path( L"me" );
 
-        userCache_.CacheObject( *ret );
-        return std::unique_ptr<sptf::WebApi_User>( std::move( ret ) );
-    }
+    const auto responseJson = co_await GetJsonResponseAsync( builder.to_uri(), abort );
+    auto ret = responseJson.get<std::unique_ptr<WebApi_User>>();
+
+    userCache_.CacheObject( *ret );
+    co_return std::shared_ptr<const WebApi_User>( std::move( ret ) );
 }
 
 void WebApi_Backend::RefreshCacheForTracks( nonstd::span<const std::string> trackIds, abort_callback& abort )
 {
-    constexpr size_t kMaxItemsPerRequest = 50;
+    RefreshCacheForTracksAsync( trackIds | ranges::to_vector, abort ).get();
+}
 
+pplx::task<void> WebApi_Backend::RefreshCacheForTracksAsync( std::vector<std::string> trackIds, abort_callback& abort )
+{
     // remove duplicates
     const auto uniqueIds = trackIds | ranges::to<std::unordered_set<std::string>>;
+    const auto idsToFetch =
+        uniqueIds
+        | ranges::views::remove_if( [&]( const auto& id ) { return trackCache_.IsCached( id ); } )
+        | ranges::to_vector;
 
-    for ( const auto& trackIdsChunk:
-          uniqueIds
-              | ranges::views::remove_if( [&]( const auto& id ) { return trackCache_.IsCached( id ); } )
-              | ranges::views::chunk( kMaxItemsPerRequest ) )
+    for ( const auto& trackIdsChunk: idsToFetch | ranges::views::chunk( kMaxIdsPerRequest ) )
     {
-        const auto trackIdsStr = qwr::unicode::ToWide( qwr::string::Join( trackIdsChunk | ranges::to_vector, ',' ) );
-
-        web::uri_builder builder;
-        builder
-            .append_path( L"tracks" )
-            .append_query( L"ids", trackIdsStr );
-
-        const auto responseJson = GetJsonResponse( builder.to_uri(), abort );
-        const auto tracksIt = responseJson.find( "tracks" );
-        qwr::QwrException::ExpectTrue( responseJson.cend() != tracksIt,
-                                       L"Malformed track data response response: missing `tracks`" );
-
-        auto ret = tracksIt->get<std::vector<std::unique_ptr<const WebApi_Track>>>();
-        trackCache_.CacheObjects( ret );
+        co_await FetchTracksAsync( trackIdsChunk | ranges::to_vector, abort );
     }
 }
 
-std::unique_ptr<const sptf::WebApi_Track>
+std::shared_ptr<const sptf::WebApi_Track>
 WebApi_Backend::GetTrack( const std::string& trackId, abort_callback& abort, bool useRelink )
 {
-    // don't want to cache relinked tracks
+    return GetTrackAsync( trackId, abort, useRelink ).get();
+}
 
-    if ( auto trackOpt = trackCache_.GetObjectFromCache( trackId );
-         !useRelink && trackOpt )
-    {
-        return std::unique_ptr<sptf::WebApi_Track>( std::move( *trackOpt ) );
-    }
-    else
-    {
+pplx::task<std::shared_ptr<const WebApi_Track>>
+WebApi_Backend::GetTrackAsync( std::string trackId, abort_callback& abort, bool useRelink )
+{
+    if ( useRelink )
+    { // don't want to cache relinked tracks
         web::uri_builder builder;
         builder
             .append_path( L"tracks" )
             .append_path( qwr::unicode::ToWide( trackId ) );
-        if ( useRelink )
+        if ( const auto countryOpt = ( co_await GetUserAsync( abort ) )->country;
+             countryOpt )
         {
-            if ( const auto countryOpt = GetUser( abort )->country;
-                 countryOpt )
-            {
-                builder.append_query( L"market", qwr::unicode::ToWide( *countryOpt ) );
-            }
+            builder.append_query( L"market", qwr::unicode::ToWide( *countryOpt ) );
         }
 
-        const auto responseJson = GetJsonResponse( builder.to_uri(), abort );
-        auto ret = responseJson.get<std::unique_ptr<WebApi_Track>>();
+        const auto responseJson = co_await GetJsonResponseAsync( builder.to_uri(), abort );
+        co_return responseJson.get<std::shared_ptr<const WebApi_Track>>();
+    }
 
-        if ( !useRelink )
-        {
-            trackCache_.CacheObject( *ret );
-        }
-        return std::unique_ptr<sptf::WebApi_Track>( std::move( ret ) );
+    if ( auto pTrack = trackCache_.GetObjectFromCache( trackId );
+         pTrack )
+    {
+        co_return pTrack;
     }
+
+    auto pTrack = co_await trackRequests_.ExecuteAsync(
+        trackId, [&] {
+            // might've been fetched by a concurrent request that has just finished
+            if ( auto pTrack = trackCache_.GetObjectFromCache( trackId );
+                 pTrack )
+            {
+                return pplx::task_from_result( pTrack );
+            }
+            return trackBatcher_.ExecuteAsync( trackId, abort );
+        },
+        abort );
+    qwr::QwrException::ExpectTrue( !!pTrack, "Failed to get track data: {}", trackId );
+
+    co_return pTrack;
 }
 
-std::vector<std::unique_ptr<const WebApi_Track>>
+std::vector<std::shared_ptr<const WebApi_Track>>
 WebApi_Backend::GetTracks( nonstd::span<const std::string> trackIds, abort_callback& abort )
 {
-    RefreshCacheForTracks( trackIds, abort );
+    return GetTracksAsync( trackIds | ranges::to_vector, abort ).get();
+}
 
-    return trackIds | ranges::views::transform( [&]( const auto& id ) -> std::unique_ptr<const WebApi_Track> {
-               assert( trackCache_.IsCached( id ) );
-               return std::move( *trackCache_.GetObjectFromCache( id ) );
-           } )
-           | ranges::to_vector;
+pplx::task<std::vector<std::shared_ptr<const WebApi_Track>>>
+WebApi_Backend::GetTracksAsync( std::vector<std::string> trackIds, abort_callback& abort )
+{
+    co_await RefreshCacheForTracksAsync( trackIds, abort );
+
+    co_return trackIds | ranges::views::transform( [&]( const auto& id ) {
+                  auto pTrack = trackCache_.GetObjectFromCache( id );
+                  qwr::QwrException::ExpectTrue( !!pTrack, "Failed to get track data: {}", id );
+                  return pTrack;
+              } )
+        | ranges::to_vector;
 }
 
 std::tuple<
-    std::vector<std::unique_ptr<const WebApi_Track>>,
-    std::vector<std::unique_ptr<const WebApi_LocalTrack>>>
+    std::vector<std::shared_ptr<const WebApi_Track>>,
+    std::vector<std::shared_ptr<const WebApi_LocalTrack>>>
 WebApi_Backend::GetTracksFromPlaylist( const std::string& playlistId, abort_callback& abort )
+{
+    return GetTracksFromPlaylistAsync( playlistId, abort ).get();
+}
+
+pplx::task<std::tuple<
+    std::vector<std::shared_ptr<const WebApi_Track>>,
+    std::vector<std::shared_ptr<const WebApi_LocalTrack>>>>
+WebApi_Backend::GetTracksFromPlaylistAsync( std::string playlistId, abort_callback& abort )
 {
     constexpr size_t kMaxItemsPerRequest = 100;
+    // requests are still throttled by rps limiter: this only hides the latency
+    constexpr size_t kMaxParallelRequests = 8;
 
-    auto requestUri = [&] {
+    const auto getRequestUri = [&]( size_t offset ) {
         web::uri_builder builder;
         builder
             .append_path( fmt::format( L"playlists/{}/tracks", qwr::unicode::ToWide( playlistId ) ) )
             .append_query( L"limit", kMaxItemsPerRequest, false );
+        if ( offset )
+        {
+            builder.append_query( L"offset", offset, false );
+        }
 
         return builder.to_uri();
-    }();
+    };
 
-    std::vector<std::unique_ptr<const WebApi_Track>> tracks;
-    std::vector<std::unique_ptr<const WebApi_LocalTrack>> localTracks;
-    while ( true )
-    {
-        const auto responseJson = GetJsonResponse( requestUri, abort );
-        const auto pPagingObject = responseJson.get<std::unique_ptr<const WebApi_PagingObject>>();
+    std::vector<std::shared_ptr<WebApi_Track>> tracks;
+    std::vector<std::shared_ptr<const WebApi_LocalTrack>> localTracks;
+    const auto parsePage = [&]( const nlohmann::json& responseJson ) {
+        auto pPagingObject = responseJson.get<std::unique_ptr<const WebApi_PagingObject>>();
 
         auto playlistTracks = pPagingObject->items.get<std::vector<std::unique_ptr<WebApi_PlaylistTrack>>>();
         for ( auto& playlistTrack: playlistTracks )
@@ -193,11 +262,11 @@ WebApi_Backend::GetTracksFromPlaylist( const std::string& playlistId, abort_call
                 using T = std::decay_t<decltype( arg )>;
                 if constexpr ( std::is_same_v<T, WebApi_Track> )
                 {
-                    tracks.emplace_back( std::make_unique<T>( std::move( arg ) ) );
+                    tracks.emplace_back( std::make_shared<T>( std::move( arg ) ) );
                 }
                 else if constexpr ( std::is_same_v<T, WebApi_LocalTrack> )
                 {
-                    localTracks.emplace_back( std::make_unique<T>( std::move( arg ) ) );
+                    localTracks.emplace_back( std::make_shared<T>( std::move( arg ) ) );
                 }
                 else
                 {
@@ -207,47 +276,84 @@ WebApi_Backend::GetTracksFromPlaylist( const std::string& playlistId, abort_call
                         *playlistTrack->track );
         }
 
-        if ( !pPagingObject->next )
+        return pPagingObject;
+    };
+
+    const auto pFirstPage = parsePage( co_await GetJsonResponseAsync( getRequestUri( 0 ), abort ) );
+    if ( pFirstPage->next )
+    { // offsets of all the remaining pages are known, so they can be requested in parallel
+        qwr::QwrException::ExpectTrue( pFirstPage->limit, "Malformed paging object: `limit` is zero" );
+
+        std::deque<pplx::task<nlohmann::json>> pendingRequests;
+        std::exception_ptr pException;
+        try
         {
-            break;
+            size_t nextOffset = pFirstPage->limit;
+            while ( nextOffset < pFirstPage->total || !pendingRequests.empty() )
+            {
+                if ( nextOffset < pFirstPage->total && pendingRequests.size() < kMaxParallelRequests )
+                {
+                    pendingRequests.emplace_back( GetJsonResponseAsync( getRequestUri( nextOffset ), abort ) );
+                    nextOffset += pFirstPage->limit;
+                    continue;
+                }
+
+                // pages are parsed in order, so that the order of tracks is preserved
+                auto request = std::move( pendingRequests.front() );
+                pendingRequests.pop_front();
+                parsePage( co_await request );
+            }
+        }
+        catch ( ... )
+        {
+            pException = std::current_exception();
         }
 
-        requestUri = *pPagingObject->next;
+        if ( pException )
+        { // pending requests reference `abort`, which might be destroyed by the caller right after the return
+            for ( auto& request: pendingRequests )
+            {
+                try
+                {
+                    (void)co_await request;
+                }
+                catch ( ... )
+                {
+                }
+            }
+            std::rethrow_exception( pException );
+        }
     }
 
     trackCache_.CacheObjects( tracks );
-    return { std::move( tracks ), std::move( localTracks ) };
+    co_return std::make_tuple( std::vector<std::shared_ptr<const WebApi_Track>>( tracks.cbegin(), tracks.cend() ), std::move( localTracks ) );
 }
 
-std::vector<std::unique_ptr<const sptf::WebApi_Track>>
+std::vector<std::shared_ptr<const sptf::WebApi_Track>>
 WebApi_Backend::GetTracksFromAlbum( const std::string& albumId, abort_callback& abort )
 {
-    std::shared_ptr<WebApi_Album_Simplified> album;
-    web::uri requestUri;
-    std::vector<std::unique_ptr<WebApi_Track_Simplified>> ret;
-    while ( true )
-    {
-        const auto responseJson = [&] {
-            if ( requestUri.is_empty() )
-            { // first paging object (and uri) is retrieved from album
-                web::uri_builder builder;
-                builder.append_path( fmt::format( L"albums/{}", qwr::unicode::ToWide( albumId ) ) );
+    return GetTracksFromAlbumAsync( albumId, abort ).get();
+}
 
-                const auto responseJson = GetJsonResponse( builder.to_uri(), abort );
-                responseJson.get_to( album );
+pplx::task<std::vector<std::shared_ptr<const WebApi_Track>>>
+WebApi_Backend::GetTracksFromAlbumAsync( std::string albumId, abort_callback& abort )
+{
+    web::uri_builder builder;
+    builder.append_path( fmt::format( L"albums/{}", qwr::unicode::ToWide( albumId ) ) );
 
-                const auto tracksIt = responseJson.find( "tracks" );
-                qwr::QwrException::ExpectTrue( responseJson.cend() != tracksIt,
-                                               L"Malformed track data response: missing `tracks`" );
+    const auto albumJson = co_await GetJsonResponseAsync( builder.to_uri(), abort );
+    std::shared_ptr<WebApi_Album_Simplified> album;
+    albumJson.get_to( album );
 
-                return *tracksIt;
-            }
-            else
-            {
-                return GetJsonResponse( requestUri, abort );
-            }
-        }();
+    const auto tracksIt = albumJson.find( "tracks" );
+    qwr::QwrException::ExpectTrue( albumJson.cend() != tracksIt,
+                                   L"Malformed track data response: missing `tracks`" );
 
+    // first paging object is retrieved from album
+    auto responseJson = *tracksIt;
+    std::vector<std::unique_ptr<WebApi_Track_Simplified>> ret;
+    while ( true )
+    {
         const auto pPagingObject = responseJson.get<std::unique_ptr<const WebApi_PagingObject>>();
 
         auto newData = pPagingObject->items.get<std::vector<std::unique_ptr<WebApi_Track_Simplified>>>();
@@ -258,21 +364,27 @@ WebApi_Backend::GetTracksFromAlbum( const std::string& albumId, abort_callback&
             break;
         }
 
-        requestUri = *pPagingObject->next;
+        responseJson = co_await GetJsonResponseAsync( web::uri( *pPagingObject->next ), abort );
     }
 
     auto newRet = ranges::views::transform( ret, [&]( auto&& elem ) {
-                      return std::make_unique<const WebApi_Track>( std::move( elem ), album );
+                      return std::make_shared<WebApi_Track>( std::move( elem ), album );
                   } )
                   | ranges::to_vector;
     trackCache_.CacheObjects( newRet );
-    return newRet;
+    co_return std::vector<std::shared_ptr<const WebApi_Track>>( newRet.cbegin(), newRet.cend() );
 }
 
-std::vector<std::unique_ptr<const WebApi_Track>>
+std::vector<std::shared_ptr<const WebApi_Track>>
 WebApi_Backend::GetTopTracksForArtist( const std::string& artistId, abort_callback& abort )
 {
-    const auto countryOpt = GetUser( abort )->country;
+    return GetTopTracksForArtistAsync( artistId, abort ).get();
+}
+
+pplx::task<std::vector<std::shared_ptr<const WebApi_Track>>>
+WebApi_Backend::GetTopTracksForArtistAsync( std::string artistId, abort_callback& abort )
+{
+    const auto countryOpt = ( co_await GetUserAsync( abort ) )->country;
     qwr::QwrException::ExpectTrue( countryOpt.has_value(),
                                    "Adding artist top tracks requires `user-read-private` permission.\n"
                                    "Re-login to update your permission scope." );
@@ -284,19 +396,19 @@ WebApi_Backend::GetTopTracksForArtist( const std::string& artistId, abort_callba
         .append_path( L"top-tracks" )
         .append_query( L"market", qwr::unicode::ToWide( *countryOpt ) );
 
-    const auto responseJson = GetJsonResponse( builder.to_uri(), abort );
+    const auto responseJson = co_await GetJsonResponseAsync( builder.to_uri(), abort );
 
     const auto tracksIt = responseJson.find( "tracks" );
     qwr::QwrException::ExpectTrue( responseJson.cend() != tracksIt,
                                    L"Malformed track data response response: missing `tracks`" );
 
-    auto ret = tracksIt->get<std::vector<std::unique_ptr<const WebApi_Track>>>();
+    auto ret = tracksIt->get<std::vector<std::shared_ptr<WebApi_Track>>>();
     trackCache_.CacheObjects( ret );
-    return ret;
+    co_return std::vector<std::shared_ptr<const WebApi_Track>>( ret.cbegin(), ret.cend() );
 }
 
 std::vector<std::unordered_multimap<std::string, std::string>>
-WebApi_Backend::GetMetaForTracks( nonstd::span<const std::unique_ptr<const WebApi_Track>> tracks )
+WebApi_Backend::GetMetaForTracks( nonstd::span<const std::shared_ptr<const WebApi_Track>> tracks )
 {
     std::vector<std::unordered_multimap<std::string, std::string>> ret;
     for ( const auto& track: tracks )
@@ -332,52 +444,54 @@ WebApi_Backend::GetMetaForTracks( nonstd::span<const std::unique_ptr<const WebAp
 }
 
 void WebApi_Backend::RefreshCacheForArtists( nonstd::span<const std::string> artistIds, abort_callback& abort )
+{
+    RefreshCacheForArtistsAsync( artistIds | ranges::to_vector, abort ).get();
+}
+
+pplx::task<void> WebApi_Backend::RefreshCacheForArtistsAsync( std::vector<std::string> artistIds, abort_callback& abort )
 {
     // remove duplicates
     const auto uniqueIds = artistIds | ranges::to<std::unordered_set<std::string>>;
+    const auto idsToFetch =
+        uniqueIds
+        | ranges::views::remove_if( [&]( const auto& id ) { return artistCache_.IsCached( id ); } )
+        | ranges::to_vector;
 
-    for ( const auto& idsChunk:
-          uniqueIds
-              | ranges::views::remove_if( [&]( const auto& id ) { return artistCache_.IsCached( id ); } )
-              | ranges::views::chunk( 50 ) )
+    for ( const auto& idsChunk: idsToFetch | ranges::views::chunk( kMaxIdsPerRequest ) )
     {
-        const auto idsStr = qwr::unicode::ToWide( qwr::string::Join( idsChunk | ranges::to_vector, ',' ) );
-
-        web::uri_builder builder;
-        builder
-            .append_path( L"artists" )
-            .append_query( L"ids", idsStr );
-
-        const auto responseJson = GetJsonResponse( builder.to_uri(), abort );
-        const auto artistsIt = responseJson.find( "artists" );
-        qwr::QwrException::ExpectTrue( responseJson.cend() != artistsIt,
-                                       L"Malformed track data response response: missing `artists`" );
-
-        auto ret = artistsIt->get<std::vector<std::unique_ptr<const WebApi_Artist>>>();
-        artistCache_.CacheObjects( ret );
+        co_await FetchArtistsAsync( idsChunk | ranges::to_vector, abort );
     }
 }
 
-std::unique_ptr<const WebApi_Artist>
+std::shared_ptr<const WebApi_Artist>
 WebApi_Backend::GetArtist( const std::string& artistId, abort_callback& abort )
 {
-    if ( auto objectOpt = artistCache_.GetObjectFromCache( artistId );
-         objectOpt )
+    return GetArtistAsync( artistId, abort ).get();
+}
+
+pplx::task<std::shared_ptr<const WebApi_Artist>>
+WebApi_Backend::GetArtistAsync( std::string artistId, abort_callback& abort )
+{
+    if ( auto pObject = artistCache_.GetObjectFromCache( artistId );
+         pObject )
     {
-        return std::unique_ptr<const WebApi_Artist>( std::move( *objectOpt ) );
+        co_return pObject;
     }
-    else
-    {
-        web::uri_builder builder;
-        builder
-            .append_path( L"artists" )
-            .append_path( qwr::unicode::ToWide( artistId ) );
 
-        const auto responseJson = GetJsonResponse( builder.to_uri(), abort );
-        auto ret = responseJson.get<std::unique_ptr<const WebApi_Artist>>();
-        artistCache_.CacheObject( *ret );
-        return std::unique_ptr<const WebApi_Artist>( std::move( ret ) );
-    }
+    auto pArtist = co_await artistRequests_.ExecuteAsync(
+        artistId, [&] {
+            // might've been fetched by a concurrent request that has just finished
+            if ( auto pObject = artistCache_.GetObjectFromCache( artistId );
+                 pObject )
+            {
+                return pplx::task_from_result( pObject );
+            }
+            return artistBatcher_.ExecuteAsync( artistId, abort );
+        },
+        abort );
+    qwr::QwrException::ExpectTrue( !!pArtist, "Failed to get artist data: {}", artistId );
+
+    co_return pArtist;
 }
 
 fs::path WebApi_Backend::GetAlbumImage( const std::string& albumId, const std::string& imgUrl, abort_callback& abort )
@@ -411,12 +525,68 @@ web::http::client::http_client_config WebApi_Backend::GetClientConfig()
     return config;
 }
 
-nlohmann::json WebApi_Backend::GetJsonResponse( const web::uri& requestUri, abort_callback& abort )
+pplx::task<std::vector<std::shared_ptr<const WebApi_Track>>>
+WebApi_Backend::FetchTracksAsync( std::vector<std::string> trackIds, abort_callback& abort )
+{
+    assert( trackIds.size() <= kMaxIdsPerRequest );
+
+    const auto trackIdsStr = qwr::unicode::ToWide( qwr::string::Join( trackIds, ',' ) );
+
+    web::uri_builder builder;
+    builder
+        .append_path( L"tracks" )
+        .append_query( L"ids", trackIdsStr );
+
+    const auto responseJson = co_await GetJsonResponseAsync( builder.to_uri(), abort );
+    const auto tracksIt = responseJson.find( "tracks" );
+    qwr::QwrException::ExpectTrue( responseJson.cend() != tracksIt && tracksIt->is_array(),
+                                   L"Malformed track data response response: missing `tracks`" );
+
+    std::vector<std::shared_ptr<WebApi_Track>> ret;
+    ret.reserve( tracksIt->size() );
+    for ( const auto& trackJson: *tracksIt )
+    { // unknown ids are returned as nulls
+        ret.emplace_back( trackJson.is_null() ? nullptr : trackJson.get<std::shared_ptr<WebApi_Track>>() );
+    }
+    trackCache_.CacheObjects( ret | ranges::views::filter( []( const auto& pObject ) { return !!pObject; } ) | ranges::to_vector );
+
+    co_return std::vector<std::shared_ptr<const WebApi_Track>>( ret.cbegin(), ret.cend() );
+}
+
+pplx::task<std::vector<std::shared_ptr<const WebApi_Artist>>>
+WebApi_Backend::FetchArtistsAsync( std::vector<std::string> artistIds, abort_callback& abort )
 {
-    return ParseResponse( GetResponse( requestUri, abort ) );
+    assert( artistIds.size() <= kMaxIdsPerRequest );
+
+    const auto idsStr = qwr::unicode::ToWide( qwr::string::Join( artistIds, ',' ) );
+
+    web::uri_builder builder;
+    builder
+        .append_path( L"artists" )
+        .append_query( L"ids", idsStr );
+
+    const auto responseJson = co_await GetJsonResponseAsync( builder.to_uri(), abort );
+    const auto artistsIt = responseJson.find( "artists" );
+    qwr::QwrException::ExpectTrue( responseJson.cend() != artistsIt && artistsIt->is_array(),
+                                   L"Malformed track data response response: missing `artists`" );
+
+    std::vector<std::shared_ptr<const WebApi_Artist>> ret;
+    ret.reserve( artistsIt->size() );
+    for ( const auto& artistJson: *artistsIt )
+    { // unknown ids are returned as nulls
+        ret.emplace_back( artistJson.is_null() ? nullptr : artistJson.get<std::shared_ptr<const WebApi_Artist>>() );
+    }
+    artistCache_.CacheObjects( ret | ranges::views::filter( []( const auto& pObject ) { return !!pObject; } ) | ranges::to_vector );
+
+    co_return ret;
 }
 
-web::http::http_response WebApi_Backend::GetResponse( const web::uri& requestUri, abort_callback& abort )
+pplx::task<nlohmann::json> WebApi_Backend::GetJsonResponseAsync( web::uri requestUri, abort_callback& abort )
+{
+    co_return co_await ParseResponseAsync( co_await GetResponseAsync( requestUri, abort ) );
+}
+
+pplx::task<web::http::http_response> WebApi_Backend::GetResponseAsync( web::uri requestUri, abort_callback& abort )
 {
     const auto adjustedRequestUri = [&] {
         const auto uriStr = requestUri.to_string();
@@ -444,9 +614,6 @@ web::http::http_response WebApi_Backend::GetResponse( const web::uri& requestUri
 
     req.set_request_uri( adjustedRequestUri );
 
-    rpsLimiter_.WaitForRequestAvailability( abort );
-    qwr::QwrException::ExpectTrue( !abort.is_aborting(), "Abort was signaled, canceling request..." );
-
     auto ctsToken = cts_.get_token();
     auto localCts = Concurrency::cancellation_token_source::create_linked_source( ctsToken );
     const auto abortableScope = abortManager_.GetAbortableScope( [&localCts] { localCts.cancel(); }, abort );
@@ -454,9 +621,17 @@ web::http::http_response WebApi_Backend::GetResponse( const web::uri& requestUri
     web::http::http_response response;
     for ( size_t i = 0; i < 3; ++i )
     {
-        response = client_.request( req, localCts.get_token() ).get();
+        for ( auto waitTime = rpsLimiter_.TryAcquire(); waitTime.count(); waitTime = rpsLimiter_.TryAcquire() )
+        { // slot might be taken by another request by the time the wait is over
+            const auto isDone = co_await WaitAbortableAsync( abortManager_, DelayAsync( waitTime ), abort );
+            qwr::QwrException::ExpectTrue( isDone, "Abort was signaled, canceling request..." );
+        }
+        qwr::QwrException::ExpectTrue( !abort.is_aborting(), "Abort was signaled, canceling request..." );
+
+        response = co_await client_.request( req, localCts.get_token() );
         if ( response.status_code() != 429 )
         {
+            rpsLimiter_.ReportSuccess();
             break;
         }
 
@@ -464,16 +639,14 @@ web::http::http_response WebApi_Backend::GetResponse( const web::uri& requestUri
         qwr::QwrException::ExpectTrue( it != response.headers().end(), "Request failed with 429 error, but does not contain a `Retry-After` header" );
 
         const auto& [_, retryHeader] = *it;
-        const auto retryInMsOpt = qwr::string::GetNumber<uint32_t>( qwr::unicode::ToU8( retryHeader ) );
-        qwr::QwrException::ExpectTrue( retryInMsOpt.has_value(), "Request failed with 429 error, but does not contain a valid number in `Retry-After` header" );
+        const auto retryInSecOpt = qwr::string::GetNumber<uint32_t>( qwr::unicode::ToU8( retryHeader ) );
+        qwr::QwrException::ExpectTrue( retryInSecOpt.has_value(), "Request failed with 429 error, but does not contain a valid number in `Retry-After` header" );
 
-        const auto retryIn = std::chrono::milliseconds( *retryInMsOpt ) + std::chrono::seconds( 1 );
+        // all requests are paused, not just this one
+        const auto retryIn = std::chrono::milliseconds( std::chrono::seconds( *retryInSecOpt + 1 ) );
         FB2K_console_formatter() << SPTF_UNDERSCORE_NAME " (error):\n"
                                  << fmt::format( L"Rate limit reached: retrying in {} ms", retryIn.count() );
-        if ( !SleepFor( retryIn, abort ) )
-        {
-            break;
-        }
+        rpsLimiter_.ReportRateLimited( retryIn );
     }
 
     if ( response.status_code() == 429 )
@@ -482,11 +655,14 @@ web::http::http_response WebApi_Backend::GetResponse( const web::uri& requestUri
                                  << fmt::format( L"Rate limit reached: retry failed" );
     }
 
-    return response;
+    co_return response;
 }
 
-nlohmann::json WebApi_Backend::ParseResponse( const web::http::http_response& response )
+pplx::task<nlohmann::json> WebApi_Backend::ParseResponseAsync( web::http::http_response response )
 {
+    // raw utf-8 data: avoids conversion to wide string
+    const auto responseBody = co_await response.extract_vector();
+
     if ( response.status_code() != 200 )
     {
         throw qwr::QwrException( L"{}: {}\n"
@@ -496,7 +672,7 @@ nlohmann::json WebApi_Backend::ParseResponse( const web::http::http_response& re
                                  [&]() -> std::wstring {
                                      try
                                      {
-                                         const auto responseJson = nlohmann::json::parse( response.extract_string().get() );
+                                         const auto responseJson = nlohmann::json::parse( responseBody.cbegin(), responseBody.cend() );
                                          return qwr::unicode::ToWide( responseJson.dump( 2 ) );
                                      }
                                      catch ( ... )
@@ -506,7 +682,7 @@ nlohmann::json WebApi_Backend::ParseResponse( const web::http::http_response& re
                                  }() );
     }
 
-    const auto responseJson = nlohmann::json::parse( response.extract_string().get() );
+    const auto responseJson = nlohmann::json::parse( responseBody.cbegin(), responseBody.cend(), FilterUnusedFields );
     if ( shouldLogWebApiResponse_ )
     {
         FB2K_console_formatter() << SPTF_UNDERSCORE_NAME " (debug): response:\n"
@@ -515,7 +691,7 @@ nlohmann::json WebApi_Backend::ParseResponse( const web::http::http_response& re
     qwr::QwrException::ExpectTrue( responseJson.is_object(),
                                    L"Malformed track data response response: json is not an object" );
 
-    return responseJson;
+    co_return responseJson;
 }
 
 } // namespace sptf
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <backend/webapi_cache.h>
+#include <utils/request_batcher.h>
 #include <utils/rps_limiter.h>
+#include <utils/single_flight.h>
 
 #include <cpprest/http_client.h>
 #include <nonstd/span.hpp>
@@ -31,34 +33,53 @@ public:
 
     WebApiAuthorizer& GetAuthorizer();
 
-    std::unique_ptr<const sptf::WebApi_User> GetUser( abort_callback& abort );
+    // Async versions are not blocking: `abort` must stay valid until the returned task is finished.
+
+    std::shared_ptr<const WebApi_User> GetUser( abort_callback& abort );
+    pplx::task<std::shared_ptr<const WebApi_User>> GetUserAsync( abort_callback& abort );
 
     void RefreshCacheForTracks( nonstd::span<const std::string> trackIds, abort_callback& abort );
+    pplx::task<void> RefreshCacheForTracksAsync( std::vector<std::string> trackIds, abort_callback& abort );
 
-    std::unique_ptr<const WebApi_Track>
+    std::shared_ptr<const WebApi_Track>
     GetTrack( const std::string& trackId, abort_callback& abort, bool useRelink = false );
+    pplx::task<std::shared_ptr<const WebApi_Track>>
+    GetTrackAsync( std::string trackId, abort_callback& abort, bool useRelink = false );
 
-    std::vector<std::unique_ptr<const WebApi_Track>>
+    std::vector<std::shared_ptr<const WebApi_Track>>
     GetTracks( nonstd::span<const std::string> trackIds, abort_callback& abort );
+    pplx::task<std::vector<std::shared_ptr<const WebApi_Track>>>
+    GetTracksAsync( std::vector<std::string> trackIds, abort_callback& abort );
 
     std::tuple<
-        std::vector<std::unique_ptr<const WebApi_Track>>,
-        std::vector<std::unique_ptr<const WebApi_LocalTrack>>>
+        std::vector<std::shared_ptr<const WebApi_Track>>,
+        std::vector<std::shared_ptr<const WebApi_LocalTrack>>>
     GetTracksFromPlaylist( const std::string& playlistId, abort_callback& abort );
+    pplx::task<std::tuple<
+        std::vector<std::shared_ptr<const WebApi_Track>>,
+        std::vector<std::shared_ptr<const WebApi_LocalTrack>>>>
+    GetTracksFromPlaylistAsync( std::string playlistId, abort_callback& abort );
 
-    std::vector<std::unique_ptr<const WebApi_Track>>
+    std::vector<std::shared_ptr<const WebApi_Track>>
     GetTracksFromAlbum( const std::string& albumId, abort_callback& abort );
+    pplx::task<std::vector<std::shared_ptr<const WebApi_Track>>>
+    GetTracksFromAlbumAsync( std::string albumId, abort_callback& abort );
 
-    std::vector<std::unique_ptr<const WebApi_Track>>
+    std::vector<std::shared_ptr<const WebApi_Track>>
     GetTopTracksForArtist( const std::string& artistId, abort_callback& abort );
+    pplx::task<std::vector<std::shared_ptr<const WebApi_Track>>>
+    GetTopTracksForArtistAsync( std::string artistId, abort_callback& abort );
 
     std::vector<std::unordered_multimap<std::string, std::string>>
-    GetMetaForTracks( nonstd::span<const std::unique_ptr<const WebApi_Track>> tracks );
+    GetMetaForTracks( nonstd::span<const std::shared_ptr<const WebApi_Track>> tracks );
 
     void RefreshCacheForArtists( nonstd::span<const std::string> artistIds, abort_callback& abort );
+    pplx::task<void> RefreshCacheForArtistsAsync( std::vector<std::string> artistIds, abort_callback& abort );
 
-    std::unique_ptr<const WebApi_Artist>
+    std::shared_ptr<const WebApi_Artist>
     GetArtist( const std::string& artistId, abort_callback& abort );
+    pplx::task<std::shared_ptr<const WebApi_Artist>>
+    GetArtistAsync( std::string artistId, abort_callback& abort );
 
     std::filesystem::path GetAlbumImage( const std::string& albumId, const std::string& imgUrl, abort_callback& abort );
     std::filesystem::path GetArtistImage( const std::string& artistId, const std::string& imgUrl, abort_callback& abort );
@@ -66,9 +87,16 @@ public:
 private:
     static web::http::client::http_client_config GetClientConfig();
 
-    nlohmann::json GetJsonResponse( const web::uri& requestUri, abort_callback& abort );
-    web::http::http_response GetResponse( const web::uri& requestUri, abort_callback& abort );
-    nlohmann::json ParseResponse( const web::http::http_response& response );
+    /// @return nullptr for unknown ids
+    pplx::task<std::vector<std::shared_ptr<const WebApi_Track>>>
+    FetchTracksAsync( std::vector<std::string> trackIds, abort_callback& abort );
+    /// @return nullptr for unknown ids
+    pplx::task<std::vector<std::shared_ptr<const WebApi_Artist>>>
+    FetchArtistsAsync( std::vector<std::string> artistIds, abort_callback& abort );
+
+    pplx::task<nlohmann::json> GetJsonResponseAsync( web::uri requestUri, abort_callback& abort );
+    pplx::task<web::http::http_response> GetResponseAsync( web::uri requestUri, abort_callback& abort );
+    pplx::task<nlohmann::json> ParseResponseAsync( web::http::http_response response );
 
 private:
     AbortManager& abortManager_;
@@ -76,15 +104,21 @@ private:
 
     bool shouldLogWebApiRequest_ = false;
     bool shouldLogWebApiResponse_ = false;
+    bool shouldLogWebApiDebug_ = false;
 
     pplx::cancellation_token_source cts_;
     std::unique_ptr<WebApiAuthorizer> pAuth_;
     web::http::client::http_client client_;
 
     WebApi_UserCache userCache_;
-    WebApi_ObjectCache<WebApi_Track> trackCache_;
+    WebApi_TrackCache trackCache_;
     WebApi_ObjectCache<WebApi_Artist> artistCache_;
 
+    SingleFlight<std::string, std::shared_ptr<const WebApi_Track>> trackRequests_;
+    SingleFlight<std::string, std::shared_ptr<const WebApi_Artist>> artistRequests_;
+    RequestBatcher<std::string, std::shared_ptr<const WebApi_Track>> trackBatcher_;
+    RequestBatcher<std::string, std::shared_ptr<const WebApi_Artist>> artistBatcher_;
+
     WebApi_ImageCache albumImageCache_;
     WebApi_ImageCache artistImageCache_;
 };
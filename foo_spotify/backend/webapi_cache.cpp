@@ -3,8 +3,8 @@
 #include "webapi_cache.h"
 
 #include <backend/spotify_instance.h>
+#include <backend/webapi_objects/webapi_media_objects.h>
 #include <backend/webapi_objects/webapi_user.h>
-#include <utils/abort_manager.h>
 #include <utils/json_std_extenders.h>
 
 #include <qwr/winapi_error_helpers.h>
@@ -104,27 +104,18 @@ public:
     }
 
 private:
-    std::unique_ptr<AbortManager::AbortableScope> pScope_;
-    std::mutex mutex_;
-    bool hasAborted_ = false;
+    abort_callback& abort_;
 };
 
 DownloadStatus::DownloadStatus( abort_callback& abort )
+    : abort_( abort )
 {
-    auto& am = SpotifyInstance::Get().GetAbortManager();
-    pScope_ = std::make_unique<AbortManager::AbortableScope>(
-        am.GetAbortableScope( [&] {
-            std::lock_guard lg( mutex_ );
-            hasAborted_ = true;
-        },
-                              abort ) );
 }
 
 HRESULT DownloadStatus::OnProgress( ULONG ulProgress, ULONG ulProgressMax,
                                     ULONG ulStatusCode, LPCWSTR wszStatusText )
-{
-    std::lock_guard lg( mutex_ );
-    return ( hasAborted_ ? E_ABORT : S_OK );
+{ // progress is reported periodically, so there is no need for abortable scope
+    return ( abort_.is_aborting() ? E_ABORT : S_OK );
 }
 
 } // namespace
@@ -132,21 +123,105 @@ HRESULT DownloadStatus::OnProgress( ULONG ulProgress, ULONG ulProgressMax,
 namespace sptf
 {
 
+WebApi_TrackCache::WebApi_TrackCache( size_t memoryCacheSize, bool usePackedStore )
+    : diskCache_( "tracks", usePackedStore )
+    , memoryCache_( memoryCacheSize )
+    , albumCache_( "albums", memoryCacheSize, usePackedStore )
+{
+}
+
+void WebApi_TrackCache::CacheObject( std::shared_ptr<WebApi_Track> pObject, bool force )
+{
+    std::lock_guard lock( cacheMutex_ );
+    CacheObject_NonBlocking( std::move( pObject ), force );
+}
+
+void WebApi_TrackCache::CacheObjects( nonstd::span<const std::shared_ptr<WebApi_Track>> objects, bool force )
+{
+    std::lock_guard lock( cacheMutex_ );
+    for ( const auto& pObject: objects )
+    {
+        CacheObject_NonBlocking( pObject, force );
+    }
+}
+
+std::shared_ptr<const WebApi_Track> WebApi_TrackCache::GetObjectFromCache( const std::string& id )
+{
+    std::lock_guard lock( cacheMutex_ );
+    return GetObjectFromCache_NonBlocking( id );
+}
+
+bool WebApi_TrackCache::IsCached( const std::string& id )
+{ // object is loaded to check that it's readable: it will likely be requested right after
+    std::lock_guard lock( cacheMutex_ );
+    return ( GetObjectFromCache_NonBlocking( id ) != nullptr );
+}
+
+WebApi_TrackCache::Stats WebApi_TrackCache::GetStats()
+{
+    std::lock_guard lock( cacheMutex_ );
+    return memoryCache_.GetStats();
+}
+
+WebApi_TrackCache::Stats WebApi_TrackCache::GetAlbumStats()
+{
+    return albumCache_.GetStats();
+}
+
+std::shared_ptr<const WebApi_Track> WebApi_TrackCache::GetObjectFromCache_NonBlocking( const std::string& id )
+{
+    if ( auto pObject = memoryCache_.Get( id ) )
+    {
+        return pObject;
+    }
+
+    auto objectOpt = diskCache_.GetObjectFromCache_NonBlocking( id );
+    if ( !objectOpt )
+    {
+        return nullptr;
+    }
+
+    auto& pTrack = *objectOpt;
+    // only album id is stored with the track
+    pTrack->album = albumCache_.GetObjectFromCache( pTrack->album->id );
+    if ( !pTrack->album )
+    { // album will be re-cached together with the track
+        return nullptr;
+    }
+
+    std::shared_ptr<const WebApi_Track> pObject( std::move( pTrack ) );
+    memoryCache_.Put( id, pObject );
+    return pObject;
+}
+
+void WebApi_TrackCache::CacheObject_NonBlocking( std::shared_ptr<WebApi_Track> pObject, bool force )
+{
+    // tracks from the same album should share the album object, even if they were fetched separately
+    pObject->album = albumCache_.CacheObject( pObject->album, force );
+
+    const auto& id = pObject->id;
+    if ( !diskCache_.CacheObject_NonBlocking( *pObject, id, force ) )
+    { // memory tier (if it has the object) is in sync with the disk one
+        return;
+    }
+    memoryCache_.Put( id, std::move( pObject ) );
+}
+
 WebApi_UserCache::WebApi_UserCache()
-    : jsonCache_( "" )
+    : diskCache_( "" )
 {
 }
 
 void WebApi_UserCache::CacheObject( const WebApi_User& object, bool force /*= false */ )
 {
     std::lock_guard lock( cacheMutex_ );
-    jsonCache_.CacheObject_NonBlocking( object, "me", force );
+    diskCache_.CacheObject_NonBlocking( object, "me", force );
 }
 
 std::optional<std::unique_ptr<sptf::WebApi_User>> WebApi_UserCache::GetObjectFromCache()
 {
     std::lock_guard lock( cacheMutex_ );
-    return jsonCache_.GetObjectFromCache_NonBlocking( "me" );
+    return diskCache_.GetObjectFromCache_NonBlocking( "me" );
 }
 
 WebApi_ImageCache::WebApi_ImageCache( const std::string& cacheSubdir )
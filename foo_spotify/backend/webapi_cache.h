@@ -1,7 +1,10 @@
 #pragma once
 
+#include <backend/webapi_cache_store.h>
+#include <utils/binary_serializer.h>
+#include <utils/lru_cache.h>
+
 #include <nonstd/span.hpp>
-#include <qwr/file_helpers.h>
 
 #include <filesystem>
 #include <memory>
@@ -10,122 +13,193 @@
 namespace sptf
 {
 
+/// Objects are stored in a compact binary form prefixed with the format version.
+/// Objects with a different version are treated as missing and are dropped from the store.
 template <typename T>
-class WebApi_JsonCache
+class WebApi_BinaryCache
 {
+    /// Must be bumped whenever serialized representation of any cached object changes
+    static constexpr uint32_t kFormatVersion = 2;
+
 public:
-    WebApi_JsonCache( const std::string& cacheSubdir )
-        : cacheSubdir_( cacheSubdir )
+    WebApi_BinaryCache( const std::string& cacheSubdir, bool usePackedStore = false )
+        : pStore_( CreateCacheStore( cacheSubdir, usePackedStore ) )
     {
     }
 
     std::optional<std::unique_ptr<T>>
     GetObjectFromCache_NonBlocking( const std::string& filename )
     {
-        namespace fs = std::filesystem;
-
-        const auto filePath = GetCachedPath( filename );
-        if ( !fs::exists( filePath ) )
+        const auto dataOpt = pStore_->Get( filename );
+        if ( !dataOpt )
         {
             return std::nullopt;
         }
 
-        const auto data = qwr::file::ReadFile( filePath, CP_UTF8, false );
         try
         {
-            return nlohmann::json::parse( data ).get<std::unique_ptr<T>>();
-        }
-        catch ( const nlohmann::detail::exception& )
-        {
-            return std::nullopt;
-        }
-    }
+            BinaryReader r( *dataOpt );
 
-    void CacheObject_NonBlocking( const T& object, const std::string& filename, bool force )
-    {
-        namespace fs = std::filesystem;
-
-        const auto filePath = GetCachedPath( filename );
-        if ( fs::exists( filePath ) )
-        {
-            if ( !force )
+            uint32_t version = 0;
+            from_binary( r, version );
+            if ( version == kFormatVersion )
             {
-                return;
+                auto pObject = std::make_unique<T>();
+                from_binary( r, *pObject );
+                if ( r.IsAtEnd() )
+                {
+                    return std::move( pObject );
+                }
             }
-            fs::remove( filePath );
+        }
+        catch ( const std::exception& )
+        { // e.g. qwr::QwrException or std::bad_alloc on corrupted data
         }
 
-        fs::create_directories( filePath.parent_path() );
-        qwr::file::WriteFile( filePath, nlohmann::json( object ).dump( 2 ) );
+        // stale or corrupted: should be re-fetched and re-written
+        pStore_->Remove( filename );
+        return std::nullopt;
     }
 
-    bool IsCached_NonBlocking( const std::string& filename )
+    /// @return true, if object was written
+    bool CacheObject_NonBlocking( const T& object, const std::string& filename, bool force )
     {
-        namespace fs = std::filesystem;
+        std::string data;
+        BinaryWriter w( data );
+        to_binary( w, kFormatVersion );
+        to_binary( w, object );
 
-        const auto filePath = GetCachedPath( filename );
-        return fs::exists( filePath );
+        return pStore_->Put( filename, data, force );
     }
 
 private:
-    std::filesystem::path GetCachedPath( const std::string& filename ) const
-    {
-        return path::WebApiCache() / "data" / cacheSubdir_ / fmt::format( "{}.json", filename );
-    }
-
-private:
-    std::string cacheSubdir_;
+    std::unique_ptr<WebApi_CacheStore> pStore_;
 };
 
+/// Disk cache with an in-memory LRU tier in front of it.
 template <typename T>
 class WebApi_ObjectCache
 {
 public:
-    WebApi_ObjectCache( const std::string& cacheSubdir )
-        : jsonCache_( cacheSubdir )
+    using Stats = typename LruCache<std::string, T>::Stats;
+
+public:
+    /// @param memoryCacheSize max number of objects kept in memory
+    WebApi_ObjectCache( const std::string& cacheSubdir, size_t memoryCacheSize, bool usePackedStore )
+        : diskCache_( cacheSubdir, usePackedStore )
+        , memoryCache_( memoryCacheSize )
     {
     }
 
-    void CacheObject( const T& object, bool force = false )
+    /// @return cached object: might be different from `pObject`, if the same object is already cached
+    std::shared_ptr<const T> CacheObject( std::shared_ptr<const T> pObject, bool force = false )
     {
         std::lock_guard lock( cacheMutex_ );
-        jsonCache_.CacheObject_NonBlocking( object, object.id, force );
+        return CacheObject_NonBlocking( std::move( pObject ), force );
     }
 
-    void CacheObjects( const nonstd::span<std::unique_ptr<T>> objects, bool force = false )
+    void CacheObjects( nonstd::span<const std::shared_ptr<const T>> objects, bool force = false )
     {
         std::lock_guard lock( cacheMutex_ );
         for ( const auto& pObject: objects )
         {
-            jsonCache_.CacheObject_NonBlocking( *pObject, pObject->id, force );
+            CacheObject_NonBlocking( pObject, force );
         }
     }
 
-    void CacheObjects( const nonstd::span<std::unique_ptr<const T>> objects, bool force = false )
+    /// @return nullptr, if object is not cached
+    std::shared_ptr<const T> GetObjectFromCache( const std::string& id )
     {
         std::lock_guard lock( cacheMutex_ );
-        for ( const auto& pObject: objects )
-        {
-            jsonCache_.CacheObject_NonBlocking( *pObject, pObject->id, force );
-        }
+        return GetObjectFromCache_NonBlocking( id );
     }
 
-    std::optional<std::unique_ptr<T>>
-    GetObjectFromCache( const std::string& id )
-    {
+    bool IsCached( const std::string& id )
+    { // object is loaded to check that it's readable: it will likely be requested right after
         std::lock_guard lock( cacheMutex_ );
-        return jsonCache_.GetObjectFromCache_NonBlocking( id );
+        return ( GetObjectFromCache_NonBlocking( id ) != nullptr );
     }
 
-    bool IsCached( const std::string& id )
+    Stats GetStats()
     {
         std::lock_guard lock( cacheMutex_ );
-        return jsonCache_.IsCached_NonBlocking( id );
+        return memoryCache_.GetStats();
     }
 
+private:
+    std::shared_ptr<const T> GetObjectFromCache_NonBlocking( const std::string& id )
+    {
+        if ( auto pObject = memoryCache_.Get( id ) )
+        {
+            return pObject;
+        }
+
+        auto objectOpt = diskCache_.GetObjectFromCache_NonBlocking( id );
+        if ( !objectOpt )
+        {
+            return nullptr;
+        }
+
+        std::shared_ptr<const T> pObject( std::move( *objectOpt ) );
+        memoryCache_.Put( id, pObject );
+        return pObject;
+    }
+
+    std::shared_ptr<const T> CacheObject_NonBlocking( std::shared_ptr<const T> pObject, bool force )
+    {
+        const auto& id = pObject->id;
+        if ( !diskCache_.CacheObject_NonBlocking( *pObject, id, force ) )
+        { // memory tier (if it has the object) is in sync with the disk one
+            if ( auto pCachedObject = memoryCache_.Get( id ) )
+            {
+                return pCachedObject;
+            }
+        }
+        memoryCache_.Put( id, pObject );
+        return pObject;
+    }
+
+private:
+    std::mutex cacheMutex_;
+    WebApi_BinaryCache<T> diskCache_;
+    LruCache<std::string, T> memoryCache_;
+};
+
+struct WebApi_Track;
+struct WebApi_Album_Simplified;
+
+/// Tracks are stored without album data: albums are stored in a separate cache,
+/// so that tracks from the same album share a single album object.
+class WebApi_TrackCache
+{
+public:
+    using Stats = LruCache<std::string, WebApi_Track>::Stats;
+
+public:
+    /// @param memoryCacheSize max number of tracks (and albums) kept in memory
+    WebApi_TrackCache( size_t memoryCacheSize, bool usePackedStore );
+
+    /// Album of the track is replaced with the cached one.
+    void CacheObject( std::shared_ptr<WebApi_Track> pObject, bool force = false );
+    /// Albums of the tracks are replaced with the cached ones.
+    void CacheObjects( nonstd::span<const std::shared_ptr<WebApi_Track>> objects, bool force = false );
+
+    /// @return nullptr, if track or its album is not cached
+    std::shared_ptr<const WebApi_Track> GetObjectFromCache( const std::string& id );
+    bool IsCached( const std::string& id );
+
+    Stats GetStats();
+    Stats GetAlbumStats();
+
+private:
+    std::shared_ptr<const WebApi_Track> GetObjectFromCache_NonBlocking( const std::string& id );
+    void CacheObject_NonBlocking( std::shared_ptr<WebApi_Track> pObject, bool force );
+
 private:
     std::mutex cacheMutex_;
-    WebApi_JsonCache<T> jsonCache_;
+    WebApi_BinaryCache<WebApi_Track> diskCache_;
+    LruCache<std::string, WebApi_Track> memoryCache_;
+    WebApi_ObjectCache<WebApi_Album_Simplified> albumCache_;
 };
 
 struct WebApi_User;
@@ -142,7 +216,7 @@ public:
 
 private:
     std::mutex cacheMutex_;
-    WebApi_JsonCache<WebApi_User> jsonCache_;
+    WebApi_BinaryCache<WebApi_User> diskCache_;
 };
 
 class WebApi_ImageCache
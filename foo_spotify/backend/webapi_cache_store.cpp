@@ -0,0 +1,468 @@
+#include <stdafx.h>
+
+#include "webapi_cache_store.h"
+
+#include <fb2k/advanced_config.h>
+
+#include <qwr/string_helpers.h>
+#include <qwr/winapi_error_helpers.h>
+
+#include <chrono>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+
+constexpr uint32_t kPackMagic = 0x4B505053;   // SPPK
+constexpr uint32_t kPackVersion = 1;
+constexpr uint32_t kRecordMagic = 0x44524352; // RCRD
+constexpr uint32_t kRemovedRecordSize = UINT32_MAX;
+constexpr uint64_t kMinSizeForCompaction = 1024 * 1024;
+
+#pragma pack( push )
+#pragma pack( 1 )
+struct PackHeader
+{
+    uint32_t magic;
+    uint32_t version;
+};
+
+struct RecordHeader
+{
+    uint32_t magic;
+    uint32_t idSize;
+    uint32_t dataSize;
+};
+#pragma pack( pop )
+
+std::string ReadBinaryFile( const fs::path& path )
+{
+    std::ifstream in( path, std::ios::binary );
+    qwr::QwrException::ExpectTrue( in.good(), "Failed to open cache file" );
+
+    return std::string( std::istreambuf_iterator<char>( in ), std::istreambuf_iterator<char>() );
+}
+
+void WriteBinaryFile( const fs::path& path, const std::string& data )
+{
+    std::ofstream out( path, std::ios::binary | std::ios::trunc );
+    out.write( data.data(), data.size() );
+    qwr::QwrException::ExpectTrue( out.good(), "Failed to write cache file" );
+}
+
+} // namespace
+
+namespace sptf
+{
+
+std::unique_ptr<WebApi_CacheStore> CreateCacheStore( const std::string& cacheSubdir, bool usePackedStore )
+{
+    const auto cacheDir = path::WebApiCache() / "data" / cacheSubdir;
+    if ( !usePackedStore || cacheSubdir.empty() )
+    {
+        return std::make_unique<WebApi_FileCacheStore>( cacheDir );
+    }
+
+    try
+    {
+        auto pStore = std::make_unique<WebApi_PackedCacheStore>( path::WebApiCache() / "data" / fmt::format( "{}.pack", cacheSubdir ) );
+        if ( fs::exists( cacheDir ) )
+        { // one-time migration: will be repeated on the next start if it fails midway
+            pStore->Import( cacheDir );
+            fs::remove_all( cacheDir );
+        }
+
+        return pStore;
+    }
+    catch ( const std::exception& e )
+    {
+        FB2K_console_formatter() << SPTF_UNDERSCORE_NAME " (error):\n"
+                                 << fmt::format( "Failed to open packed cache `{}`, falling back to per-file cache:\n{}", cacheSubdir, e.what() );
+        return std::make_unique<WebApi_FileCacheStore>( cacheDir );
+    }
+}
+
+WebApi_FileCacheStore::WebApi_FileCacheStore( const fs::path& cacheDir )
+    : cacheDir_( cacheDir )
+{
+}
+
+std::optional<std::string> WebApi_FileCacheStore::Get( const std::string& id )
+{
+    for ( const auto& filePath: { GetObjectPath( id ), GetLegacyObjectPath( id ) } )
+    {
+        if ( fs::exists( filePath ) )
+        {
+            return ReadBinaryFile( filePath );
+        }
+    }
+
+    return std::nullopt;
+}
+
+bool WebApi_FileCacheStore::Put( const std::string& id, const std::string& data, bool force )
+{
+    const auto filePath = GetObjectPath( id );
+    if ( fs::exists( filePath ) || fs::exists( GetLegacyObjectPath( id ) ) )
+    {
+        if ( !force )
+        {
+            return false;
+        }
+        Remove( id );
+    }
+
+    fs::create_directories( filePath.parent_path() );
+    WriteBinaryFile( filePath, data );
+    return true;
+}
+
+void WebApi_FileCacheStore::Remove( const std::string& id )
+{
+    fs::remove( GetObjectPath( id ) );
+    fs::remove( GetLegacyObjectPath( id ) );
+}
+
+fs::path WebApi_FileCacheStore::GetObjectPath( const std::string& id ) const
+{
+    return cacheDir_ / fmt::format( "{}.dat", id );
+}
+
+fs::path WebApi_FileCacheStore::GetLegacyObjectPath( const std::string& id ) const
+{
+    return cacheDir_ / fmt::format( "{}.json", id );
+}
+
+WebApi_PackedCacheStore::WebApi_PackedCacheStore( const fs::path& packPath )
+    : shouldLogWebApiDebug_( config::advanced::logging_webapi_debug )
+    , packPath_( packPath )
+{
+    const auto startTime = std::chrono::steady_clock::now();
+
+    try
+    {
+        Open();
+        if ( deadSize_ >= kMinSizeForCompaction && deadSize_ * 2 >= fileSize_ )
+        {
+            Compact();
+        }
+    }
+    catch ( ... )
+    { // destructor won't be called
+        Close();
+        throw;
+    }
+
+    if ( shouldLogWebApiDebug_ )
+    {
+        const auto loadTime = std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now() - startTime );
+        FB2K_console_formatter() << SPTF_UNDERSCORE_NAME " (debug):\n"
+                                 << fmt::format( "{}: {} objects ({} KB) loaded in {} ms",
+                                                 qwr::unicode::ToU8( packPath_.filename().wstring() ),
+                                                 index_.size(),
+                                                 fileSize_ / 1024,
+                                                 loadTime.count() );
+    }
+}
+
+WebApi_PackedCacheStore::~WebApi_PackedCacheStore()
+{
+    Close();
+}
+
+std::optional<std::string> WebApi_PackedCacheStore::Get( const std::string& id )
+{
+    const auto it = index_.find( id );
+    if ( it == index_.end() )
+    {
+        return std::nullopt;
+    }
+
+    const auto& location = it->second;
+    Map( location.dataOffset + location.dataSize );
+    return std::string( reinterpret_cast<const char*>( pView_ + location.dataOffset ), location.dataSize );
+}
+
+bool WebApi_PackedCacheStore::Put( const std::string& id, const std::string& data, bool force )
+{
+    if ( !force && index_.find( id ) != index_.end() )
+    {
+        return false;
+    }
+
+    Append( id, data );
+    return true;
+}
+
+void WebApi_PackedCacheStore::Remove( const std::string& id )
+{
+    if ( index_.find( id ) == index_.end() )
+    {
+        return;
+    }
+
+    Append( id, std::nullopt );
+}
+
+void WebApi_PackedCacheStore::Import( const fs::path& cacheDir )
+{
+    const auto startTime = std::chrono::steady_clock::now();
+
+    size_t count = 0;
+    for ( const auto& entry: fs::directory_iterator( cacheDir ) )
+    {
+        const auto& filePath = entry.path();
+        if ( !entry.is_regular_file() || ( filePath.extension() != ".dat" && filePath.extension() != ".json" ) )
+        {
+            continue;
+        }
+
+        if ( Put( qwr::unicode::ToU8( filePath.stem().wstring() ), ReadBinaryFile( filePath ), false ) )
+        {
+            ++count;
+        }
+    }
+
+    if ( shouldLogWebApiDebug_ )
+    {
+        const auto importTime = std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now() - startTime );
+        FB2K_console_formatter() << SPTF_UNDERSCORE_NAME " (debug):\n"
+                                 << fmt::format( "{}: {} objects imported in {} ms",
+                                                 qwr::unicode::ToU8( packPath_.filename().wstring() ),
+                                                 count,
+                                                 importTime.count() );
+    }
+}
+
+void WebApi_PackedCacheStore::Open()
+{
+    fs::create_directories( packPath_.parent_path() );
+
+    hFile_ = CreateFile( packPath_.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr );
+    qwr::error::CheckWinApi( hFile_ != INVALID_HANDLE_VALUE, "CreateFile" );
+
+    LARGE_INTEGER fileSize{};
+    auto bRet = GetFileSizeEx( hFile_, &fileSize );
+    qwr::error::CheckWinApi( bRet, "GetFileSizeEx" );
+    fileSize_ = static_cast<uint64_t>( fileSize.QuadPart );
+
+    if ( const auto validSize = LoadIndex(); !validSize || validSize != fileSize_ )
+    { // new file, incompatible format or incomplete write
+        Reset( validSize );
+    }
+}
+
+void WebApi_PackedCacheStore::Close()
+{
+    Unmap();
+    if ( hFile_ != INVALID_HANDLE_VALUE )
+    {
+        CloseHandle( hFile_ );
+        hFile_ = INVALID_HANDLE_VALUE;
+    }
+
+    fileSize_ = 0;
+    deadSize_ = 0;
+    index_.clear();
+}
+
+uint64_t WebApi_PackedCacheStore::LoadIndex()
+{
+    index_.clear();
+    deadSize_ = 0;
+
+    if ( fileSize_ < sizeof( PackHeader ) )
+    {
+        return 0;
+    }
+
+    Map( fileSize_ );
+
+    const auto& packHeader = *reinterpret_cast<const PackHeader*>( pView_ );
+    if ( packHeader.magic != kPackMagic || packHeader.version != kPackVersion )
+    {
+        return 0;
+    }
+
+    uint64_t pos = sizeof( PackHeader );
+    while ( fileSize_ - pos >= sizeof( RecordHeader ) )
+    {
+        const auto& header = *reinterpret_cast<const RecordHeader*>( pView_ + pos );
+        const bool isRemoved = ( header.dataSize == kRemovedRecordSize );
+        const uint64_t recordSize = sizeof( RecordHeader ) + header.idSize + ( isRemoved ? 0 : header.dataSize );
+        if ( header.magic != kRecordMagic || fileSize_ - pos < recordSize )
+        {
+            break;
+        }
+
+        // newer records override the old ones
+        const std::string id( reinterpret_cast<const char*>( pView_ + pos + sizeof( RecordHeader ) ), header.idSize );
+        if ( isRemoved )
+        {
+            UpdateIndex( id, std::nullopt );
+        }
+        else
+        {
+            UpdateIndex( id, RecordLocation{ pos + sizeof( RecordHeader ) + header.idSize, header.dataSize } );
+        }
+
+        pos += recordSize;
+    }
+
+    return pos;
+}
+
+void WebApi_PackedCacheStore::Reset( uint64_t newSize )
+{
+    Unmap();
+
+    LARGE_INTEGER pos{};
+    pos.QuadPart = static_cast<LONGLONG>( newSize );
+    auto bRet = SetFilePointerEx( hFile_, pos, nullptr, FILE_BEGIN );
+    qwr::error::CheckWinApi( bRet, "SetFilePointerEx" );
+    bRet = SetEndOfFile( hFile_ );
+    qwr::error::CheckWinApi( bRet, "SetEndOfFile" );
+    fileSize_ = newSize;
+
+    if ( !newSize )
+    {
+        const PackHeader header{ kPackMagic, kPackVersion };
+        WriteAt( 0, &header, sizeof( header ) );
+        fileSize_ = sizeof( header );
+    }
+}
+
+void WebApi_PackedCacheStore::Compact()
+{
+    // view might've been released by `Reset`
+    Map( fileSize_ );
+
+    const auto tmpPath = fs::path( packPath_ ).concat( ".tmp" );
+    {
+        std::ofstream out( tmpPath, std::ios::binary | std::ios::trunc );
+
+        const PackHeader packHeader{ kPackMagic, kPackVersion };
+        out.write( reinterpret_cast<const char*>( &packHeader ), sizeof( packHeader ) );
+        for ( const auto& [id, location]: index_ )
+        {
+            const RecordHeader header{ kRecordMagic, static_cast<uint32_t>( id.size() ), location.dataSize };
+            out.write( reinterpret_cast<const char*>( &header ), sizeof( header ) );
+            out.write( id.data(), id.size() );
+            out.write( reinterpret_cast<const char*>( pView_ + location.dataOffset ), location.dataSize );
+        }
+
+        qwr::QwrException::ExpectTrue( out.good(), "Failed to write compacted cache file" );
+    }
+
+    Close();
+    fs::rename( tmpPath, packPath_ );
+    Open();
+}
+
+void WebApi_PackedCacheStore::Map( uint64_t size )
+{
+    if ( size <= viewSize_ )
+    {
+        return;
+    }
+
+    // file has grown: the whole file is remapped
+    Unmap();
+
+    hMapping_ = CreateFileMapping( hFile_, nullptr, PAGE_READONLY, 0, 0, nullptr );
+    qwr::error::CheckWinApi( hMapping_ != nullptr, "CreateFileMapping" );
+
+    pView_ = static_cast<const uint8_t*>( MapViewOfFile( hMapping_, FILE_MAP_READ, 0, 0, 0 ) );
+    qwr::error::CheckWinApi( pView_ != nullptr, "MapViewOfFile" );
+
+    viewSize_ = fileSize_;
+}
+
+void WebApi_PackedCacheStore::Unmap()
+{
+    if ( pView_ )
+    {
+        UnmapViewOfFile( pView_ );
+        pView_ = nullptr;
+    }
+    if ( hMapping_ )
+    {
+        CloseHandle( hMapping_ );
+        hMapping_ = nullptr;
+    }
+    viewSize_ = 0;
+}
+
+void WebApi_PackedCacheStore::Append( const std::string& id, const std::optional<std::string>& data )
+{
+    const RecordHeader header{ kRecordMagic,
+                               static_cast<uint32_t>( id.size() ),
+                               ( data ? static_cast<uint32_t>( data->size() ) : kRemovedRecordSize ) };
+
+    std::string record;
+    record.reserve( sizeof( header ) + id.size() + ( data ? data->size() : 0 ) );
+    record.append( reinterpret_cast<const char*>( &header ), sizeof( header ) );
+    record.append( id );
+    if ( data )
+    {
+        record.append( *data );
+    }
+
+    // record is written in one go, so that incomplete write is detected on load
+    WriteAt( fileSize_, record.data(), record.size() );
+
+    const auto dataOffset = fileSize_ + sizeof( header ) + id.size();
+    fileSize_ += record.size();
+
+    if ( data )
+    {
+        UpdateIndex( id, RecordLocation{ dataOffset, header.dataSize } );
+    }
+    else
+    {
+        UpdateIndex( id, std::nullopt );
+    }
+}
+
+void WebApi_PackedCacheStore::UpdateIndex( const std::string& id, std::optional<RecordLocation> location )
+{
+    const auto it = index_.find( id );
+    if ( it != index_.end() )
+    {
+        deadSize_ += sizeof( RecordHeader ) + it->first.size() + it->second.dataSize;
+    }
+
+    if ( !location )
+    { // removal record is not needed after compaction either
+        deadSize_ += sizeof( RecordHeader ) + id.size();
+        if ( it != index_.end() )
+        {
+            index_.erase( it );
+        }
+        return;
+    }
+
+    if ( it != index_.end() )
+    {
+        it->second = *location;
+    }
+    else
+    {
+        index_.emplace( id, *location );
+    }
+}
+
+void WebApi_PackedCacheStore::WriteAt( uint64_t offset, const void* data, size_t size )
+{
+    OVERLAPPED overlapped{};
+    overlapped.Offset = static_cast<DWORD>( offset );
+    overlapped.OffsetHigh = static_cast<DWORD>( offset >> 32 );
+
+    DWORD bytesWritten = 0;
+    const auto bRet = WriteFile( hFile_, data, static_cast<DWORD>( size ), &bytesWritten, &overlapped );
+    qwr::error::CheckWinApi( bRet && bytesWritten == size, "WriteFile" );
+}
+
+} // namespace sptf
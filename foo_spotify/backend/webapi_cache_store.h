@@ -0,0 +1,104 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace sptf
+{
+
+/// Storage for serialized Web API objects.
+/// Not thread-safe: all calls must be synchronized by the owner.
+class WebApi_CacheStore
+{
+public:
+    virtual ~WebApi_CacheStore() = default;
+
+    virtual std::optional<std::string> Get( const std::string& id ) = 0;
+    /// @return true, if object was written
+    virtual bool Put( const std::string& id, const std::string& data, bool force ) = 0;
+    virtual void Remove( const std::string& id ) = 0;
+};
+
+/// Creates the store for the specified cache sub-directory.
+/// When packed store is requested, the existing per-file cache is migrated to it.
+std::unique_ptr<WebApi_CacheStore> CreateCacheStore( const std::string& cacheSubdir, bool usePackedStore );
+
+/// One file per object.
+/// Files from the old JSON-only layout are read as well (and are replaced on write).
+class WebApi_FileCacheStore : public WebApi_CacheStore
+{
+public:
+    WebApi_FileCacheStore( const std::filesystem::path& cacheDir );
+    ~WebApi_FileCacheStore() override = default;
+
+    std::optional<std::string> Get( const std::string& id ) override;
+    bool Put( const std::string& id, const std::string& data, bool force ) override;
+    void Remove( const std::string& id ) override;
+
+private:
+    std::filesystem::path GetObjectPath( const std::string& id ) const;
+    std::filesystem::path GetLegacyObjectPath( const std::string& id ) const;
+
+private:
+    std::filesystem::path cacheDir_;
+};
+
+/// All objects in a single append-only file:
+/// the index of object locations is built on open, reads are served from the file mapping.
+/// Overwritten records are discarded by compaction on open.
+class WebApi_PackedCacheStore : public WebApi_CacheStore
+{
+    struct RecordLocation
+    {
+        uint64_t dataOffset;
+        uint32_t dataSize;
+    };
+
+public:
+    /// @throw qwr::QwrException
+    WebApi_PackedCacheStore( const std::filesystem::path& packPath );
+    ~WebApi_PackedCacheStore() override;
+
+    std::optional<std::string> Get( const std::string& id ) override;
+    bool Put( const std::string& id, const std::string& data, bool force ) override;
+    void Remove( const std::string& id ) override;
+
+    /// Imports all objects from the per-file cache directory.
+    /// @throw qwr::QwrException
+    void Import( const std::filesystem::path& cacheDir );
+
+private:
+    void Open();
+    void Close();
+    /// @return size of the valid data
+    uint64_t LoadIndex();
+    void Reset( uint64_t newSize );
+    void Compact();
+
+    /// Ensures that file mapping covers `size` bytes
+    void Map( uint64_t size );
+    void Unmap();
+
+    /// @param data nullopt - removal record
+    void Append( const std::string& id, const std::optional<std::string>& data );
+    void UpdateIndex( const std::string& id, std::optional<RecordLocation> location );
+    void WriteAt( uint64_t offset, const void* data, size_t size );
+
+private:
+    const bool shouldLogWebApiDebug_;
+    const std::filesystem::path packPath_;
+
+    HANDLE hFile_ = INVALID_HANDLE_VALUE;
+    HANDLE hMapping_ = nullptr;
+    const uint8_t* pView_ = nullptr;
+    uint64_t viewSize_ = 0;
+
+    uint64_t fileSize_ = 0;
+    uint64_t deadSize_ = 0;
+    std::unordered_map<std::string, RecordLocation> index_;
+};
+
+} // namespace sptf
@@ -7,6 +7,8 @@
 namespace sptf
 {
 
+class BinaryWriter;
+class BinaryReader;
 struct WebApi_Artist_Simplified;
 struct WebApi_Image;
 
@@ -28,5 +30,7 @@ struct WebApi_Album_Simplified
 
 void to_json( nlohmann::json& j, const WebApi_Album_Simplified& p );
 void from_json( const nlohmann::json& j, WebApi_Album_Simplified& p );
+void to_binary( BinaryWriter& w, const WebApi_Album_Simplified& p );
+void from_binary( BinaryReader& r, WebApi_Album_Simplified& p );
 
 } // namespace sptf
\ No newline at end of file
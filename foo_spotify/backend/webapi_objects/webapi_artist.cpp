@@ -3,6 +3,7 @@
 #include "webapi_artist.h"
 
 #include <backend/webapi_objects/webapi_media_objects.h>
+#include <utils/binary_serializer.h>
 #include <utils/json_std_extenders.h>
 
 namespace sptf
@@ -11,4 +12,7 @@ namespace sptf
 SPTF_NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE( WebApi_Artist_Simplified, id, name );
 SPTF_NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE( WebApi_Artist, id, images, name, popularity );
 
+SPTF_BINARY_DEFINE_TYPE_NON_INTRUSIVE( WebApi_Artist_Simplified, id, name );
+SPTF_BINARY_DEFINE_TYPE_NON_INTRUSIVE( WebApi_Artist, id, images, name, popularity );
+
 } // namespace sptf
@@ -5,6 +5,8 @@
 namespace sptf
 {
 
+class BinaryWriter;
+class BinaryReader;
 struct WebApi_Image;
 
 struct WebApi_Artist_Simplified
@@ -29,8 +31,12 @@ struct WebApi_Artist
 
 void to_json( nlohmann::json& j, const WebApi_Artist_Simplified& p );
 void from_json( const nlohmann::json& j, WebApi_Artist_Simplified& p );
+void to_binary( BinaryWriter& w, const WebApi_Artist_Simplified& p );
+void from_binary( BinaryReader& r, WebApi_Artist_Simplified& p );
 
 void to_json( nlohmann::json& j, const WebApi_Artist& p );
 void from_json( const nlohmann::json& j, WebApi_Artist& p );
+void to_binary( BinaryWriter& w, const WebApi_Artist& p );
+void from_binary( BinaryReader& r, WebApi_Artist& p );
 
 } // namespace sptf
\ No newline at end of file
@@ -2,9 +2,12 @@
 
 #include "webapi_image.h"
 
+#include <utils/binary_serializer.h>
+
 namespace sptf
 {
 
 SPTF_NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE( WebApi_Image, height, url, width );
+SPTF_BINARY_DEFINE_TYPE_NON_INTRUSIVE( WebApi_Image, height, url, width );
 
 } // namespace sptf
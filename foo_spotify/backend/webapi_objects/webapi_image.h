@@ -6,6 +6,9 @@
 namespace sptf
 {
 
+class BinaryWriter;
+class BinaryReader;
+
 struct WebApi_Image
 {
     uint32_t height;
@@ -15,5 +18,7 @@ struct WebApi_Image
 
 void to_json( nlohmann::json& j, const WebApi_Image& p );
 void from_json( const nlohmann::json& j, WebApi_Image& p );
+void to_binary( BinaryWriter& w, const WebApi_Image& p );
+void from_binary( BinaryReader& r, WebApi_Image& p );
 
 } // namespace sptf
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include "webapi_track.h"
 
 #include <backend/webapi_objects/webapi_media_objects.h>
+#include <utils/binary_serializer.h>
 #include <utils/json_std_extenders.h>
 
 namespace sptf
@@ -61,4 +62,23 @@ void from_json( const nlohmann::json& nlohmann_json_j, WebApi_Track& nlohmann_js
     }
 }
 
+void to_binary( BinaryWriter& sptf_binary_w, const WebApi_Track& sptf_binary_t )
+{
+    qwr::QwrException::ExpectTrue( !!sptf_binary_t.album, "Can't serialize track without album" );
+
+    // album is cached separately, so only the reference is saved;
+    // we don't need to save `restrictions`, since it's only used on initial parsing
+    to_binary( sptf_binary_w, sptf_binary_t.album->id );
+    NLOHMANN_JSON_EXPAND( NLOHMANN_JSON_PASTE( SPTF_BINARY_TO, artists, disc_number, duration_ms, linked_from, name, preview_url, track_number, id ) )
+}
+
+void from_binary( BinaryReader& sptf_binary_r, WebApi_Track& sptf_binary_t )
+{
+    auto pAlbum = std::make_shared<WebApi_Album_Simplified>();
+    from_binary( sptf_binary_r, pAlbum->id );
+    sptf_binary_t.album = pAlbum;
+
+    NLOHMANN_JSON_EXPAND( NLOHMANN_JSON_PASTE( SPTF_BINARY_FROM, artists, disc_number, duration_ms, linked_from, name, preview_url, track_number, id ) )
+}
+
 } // namespace sptf
@@ -7,6 +7,8 @@
 namespace sptf
 {
 
+class BinaryWriter;
+class BinaryReader;
 struct WebApi_Album_Simplified;
 struct WebApi_Artist_Simplified;
 struct WebApi_Restriction;
@@ -63,5 +65,8 @@ void from_json( const nlohmann::json& j, WebApi_Track_Simplified& p );
 
 void to_json( nlohmann::json& j, const WebApi_Track& p );
 void from_json( const nlohmann::json& j, WebApi_Track& p );
+/// Only album id is (de)serialized: album object must be restored by the caller.
+void to_binary( BinaryWriter& w, const WebApi_Track& p );
+void from_binary( BinaryReader& r, WebApi_Track& p );
 
 } // namespace sptf
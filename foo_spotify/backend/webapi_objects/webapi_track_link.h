@@ -5,6 +5,9 @@
 namespace sptf
 {
 
+class BinaryWriter;
+class BinaryReader;
+
 struct WebApi_TrackLink
 {
     // external_urls 	an external URL object 	Known external URLs for this track.
@@ -16,5 +19,7 @@ struct WebApi_TrackLink
 
 void to_json( nlohmann::json& j, const WebApi_TrackLink& p );
 void from_json( const nlohmann::json& j, WebApi_TrackLink& p );
+void to_binary( BinaryWriter& w, const WebApi_TrackLink& p );
+void from_binary( BinaryReader& r, WebApi_TrackLink& p );
 
 } // namespace sptf
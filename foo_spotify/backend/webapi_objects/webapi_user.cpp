@@ -2,6 +2,7 @@
 
 #include "webapi_user.h"
 
+#include <utils/binary_serializer.h>
 #include <utils/json_std_extenders.h>
 
 namespace sptf
@@ -21,4 +22,6 @@ void from_json( const nlohmann::json& nlohmann_json_j, WebApi_User& nlohmann_jso
     }
 }
 
+SPTF_BINARY_DEFINE_TYPE_NON_INTRUSIVE( WebApi_User, country, display_name, uri );
+
 } // namespace sptf
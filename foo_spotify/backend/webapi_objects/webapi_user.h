@@ -6,6 +6,9 @@
 namespace sptf
 {
 
+class BinaryWriter;
+class BinaryReader;
+
 struct WebApi_User
 {
     std::optional<std::string> country;
@@ -22,5 +25,7 @@ struct WebApi_User
 
 void to_json( nlohmann::json& j, const WebApi_User& p );
 void from_json( const nlohmann::json& j, WebApi_User& p );
+void to_binary( BinaryWriter& w, const WebApi_User& p );
+void from_binary( BinaryReader& r, WebApi_User& p );
 
 } // namespace sptf
@@ -5,14 +5,23 @@ namespace sptf::guid
 
 constexpr GUID acfu_source = { 0xbfbd48bc, 0x9f3b, 0x42bd, { 0x8e, 0xfc, 0x9d, 0x5a, 0xf1, 0x2f, 0xf3, 0xa1 } };
 constexpr GUID adv_branch = { 0x3e2d241a, 0x306b, 0x49bc, { 0x80, 0xb3, 0x6a, 0x77, 0xe9, 0x21, 0x32, 0xc7 } };
+constexpr GUID adv_branch_cache = { 0x4a2ebfd9, 0x5d19, 0x4a33, { 0x91, 0xed, 0x8a, 0x37, 0xcf, 0x6a, 0xeb, 0xc2 } };
 constexpr GUID adv_branch_logging = { 0xa69190a1, 0x3abd, 0x4a45, { 0x9c, 0x4a, 0x66, 0xbd, 0xb, 0x7f, 0xec, 0x11 } };
 constexpr GUID adv_branch_network = { 0x53328c11, 0x156e, 0x4b5c, { 0x8f, 0x82, 0xe5, 0x3d, 0x5d, 0xb5, 0x7c, 0x2b } };
+constexpr GUID adv_branch_playback = { 0x96bbfcc4, 0x393, 0x4f64, { 0xa5, 0x9, 0x8a, 0x52, 0x28, 0xd7, 0xda, 0xf1 } };
+constexpr GUID adv_var_cache_memory_object_count = { 0xdf13a3b4, 0xbf7f, 0x49e8, { 0x8e, 0x6, 0x28, 0x7a, 0xd5, 0xa1, 0x11, 0x5 } };
+constexpr GUID adv_var_cache_use_packed_store = { 0x8e27cfd6, 0x48a0, 0x4051, { 0xb1, 0xf0, 0x77, 0xa3, 0x53, 0xd4, 0xb4, 0x43 } };
 constexpr GUID adv_var_network_proxy = { 0x2626706b, 0x19a9, 0x4ccf, { 0x85, 0xdd, 0x55, 0xd4, 0x2f, 0x8b, 0x57, 0x46 } };
 constexpr GUID adv_var_network_proxy_username = { 0xd9e86980, 0xcee4, 0x4075, { 0x96, 0xef, 0x79, 0xed, 0xba, 0x87, 0x79, 0x58 } };
 constexpr GUID adv_var_network_proxy_password = { 0xd138fb5, 0x3e6f, 0x48d6, { 0x9b, 0x44, 0x44, 0x6c, 0x78, 0xd4, 0x6f, 0xa3 } };
+constexpr GUID adv_var_logging_libspotify_debug = { 0x6cc09019, 0x816f, 0x4038, { 0x91, 0x15, 0x6f, 0x49, 0x79, 0xa1, 0xeb, 0xb5 } };
+constexpr GUID adv_var_logging_playback_debug = { 0x2bac35c8, 0xd612, 0x4634, { 0xa6, 0xa0, 0x98, 0x77, 0x66, 0xf2, 0xb9, 0xdf } };
 constexpr GUID adv_var_logging_webapi_debug = { 0xea784339, 0x21d7, 0x47ab, { 0xbc, 0xeb, 0x7a, 0xf7, 0xc, 0x8f, 0xb0, 0x18 } };
 constexpr GUID adv_var_logging_webapi_request = { 0x90066d1d, 0x1233, 0x4fcc, { 0xab, 0xc3, 0xbc, 0x17, 0xb4, 0x68, 0x65, 0x84 } };
 constexpr GUID adv_var_logging_webapi_response = { 0x349d3d49, 0xfffc, 0x4b32, { 0x8b, 0xf7, 0xc0, 0x78, 0x3a, 0x87, 0x5e, 0xa4 } };
+constexpr GUID adv_var_playback_buffer_size_in_ms = { 0xecedef41, 0x55c2, 0x4575, { 0xa4, 0x65, 0x87, 0x9d, 0x90, 0x6e, 0x6b, 0xf4 } };
+constexpr GUID adv_var_playback_chunk_coalescing_in_ms = { 0x507fc913, 0xe2af, 0x454b, { 0x8f, 0xec, 0xc2, 0xa1, 0x9b, 0x76, 0x6a, 0x10 } };
+constexpr GUID adv_var_playback_prefetch_before_end_in_s = { 0xe9e22754, 0xda8c, 0x4f40, { 0xa9, 0xf6, 0x65, 0x65, 0x88, 0x90, 0x8b, 0x69 } };
 constexpr GUID config_enable_normalization = { 0x7917bfbc, 0x3731, 0x4523, { 0xa4, 0x9e, 0xf8, 0xb3, 0x8e, 0xad, 0xbd, 0xb1 } };
 constexpr GUID config_enable_private_mode = { 0xfd7aad3c, 0x3e8f, 0x45c2, { 0xaa, 0x62, 0xbe, 0xcc, 0x55, 0xe1, 0x2d, 0xfb } };
 constexpr GUID config_libspotify_cache_size_in_mb = { 0xf23f3e, 0x5d86, 0x4092, { 0x8d, 0xf, 0xf1, 0x7d, 0x5b, 0xa1, 0x22, 0xf7 } };
@@ -11,6 +11,10 @@ advconfig_branch_factory branch_network(
     "Network: restart is required", sptf::guid::adv_branch_network, sptf::guid::adv_branch, 0 );
 advconfig_branch_factory branch_logging(
     "Logging: restart is required", sptf::guid::adv_branch_logging, sptf::guid::adv_branch, 1 );
+advconfig_branch_factory branch_playback(
+    "Playback", sptf::guid::adv_branch_playback, sptf::guid::adv_branch, 2 );
+advconfig_branch_factory branch_cache(
+    "Cache: restart is required", sptf::guid::adv_branch_cache, sptf::guid::adv_branch, 3 );
 
 } // namespace
 
@@ -47,4 +51,39 @@ qwr::fb2k::AdvConfigBool_MT logging_webapi_debug(
     sptf::guid::adv_var_logging_webapi_debug, sptf::guid::adv_branch_logging, 2,
     false );
 
+qwr::fb2k::AdvConfigBool_MT logging_playback_debug(
+    "Log playback: debug",
+    sptf::guid::adv_var_logging_playback_debug, sptf::guid::adv_branch_logging, 3,
+    false );
+
+qwr::fb2k::AdvConfigBool_MT logging_libspotify_debug(
+    "Log LibSpotify: debug",
+    sptf::guid::adv_var_logging_libspotify_debug, sptf::guid::adv_branch_logging, 4,
+    false );
+
+qwr::fb2k::AdvConfigUInt32_MT playback_buffer_size_in_ms(
+    "Audio buffer size (in ms): applied on next playback",
+    sptf::guid::adv_var_playback_buffer_size_in_ms, sptf::guid::adv_branch_playback, 0,
+    10000, 1000, 120000 );
+
+qwr::fb2k::AdvConfigUInt32_MT playback_chunk_coalescing_in_ms(
+    "Audio chunk coalescing (in ms): 0 - disabled",
+    sptf::guid::adv_var_playback_chunk_coalescing_in_ms, sptf::guid::adv_branch_playback, 1,
+    0, 0, 1000 );
+
+qwr::fb2k::AdvConfigUInt32_MT playback_prefetch_before_end_in_s(
+    "Prefetch next track (in seconds before the end of the current track): 0 - disabled",
+    sptf::guid::adv_var_playback_prefetch_before_end_in_s, sptf::guid::adv_branch_playback, 2,
+    30, 0, 600 );
+
+qwr::fb2k::AdvConfigUInt32_MT cache_memory_object_count(
+    "Web API objects kept in memory (per object type): 0 - disabled",
+    sptf::guid::adv_var_cache_memory_object_count, sptf::guid::adv_branch_cache, 0,
+    20000, 0, 1000000 );
+
+qwr::fb2k::AdvConfigBool_MT cache_use_packed_store(
+    "Store Web API objects in a single file: existing cache is migrated automatically",
+    sptf::guid::adv_var_cache_use_packed_store, sptf::guid::adv_branch_cache, 1,
+    false );
+
 } // namespace sptf::config::advanced
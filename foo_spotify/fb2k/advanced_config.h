@@ -12,5 +12,14 @@ extern qwr::fb2k::AdvConfigString_MT network_proxy_password;
 extern qwr::fb2k::AdvConfigBool_MT logging_webapi_request;
 extern qwr::fb2k::AdvConfigBool_MT logging_webapi_response;
 extern qwr::fb2k::AdvConfigBool_MT logging_webapi_debug;
+extern qwr::fb2k::AdvConfigBool_MT logging_playback_debug;
+extern qwr::fb2k::AdvConfigBool_MT logging_libspotify_debug;
+
+extern qwr::fb2k::AdvConfigUInt32_MT playback_buffer_size_in_ms;
+extern qwr::fb2k::AdvConfigUInt32_MT playback_chunk_coalescing_in_ms;
+extern qwr::fb2k::AdvConfigUInt32_MT playback_prefetch_before_end_in_s;
+
+extern qwr::fb2k::AdvConfigUInt32_MT cache_memory_object_count;
+extern qwr::fb2k::AdvConfigBool_MT cache_use_packed_store;
 
 } // namespace sptf::config::advanced
@@ -6,15 +6,19 @@
 #include <backend/spotify_object.h>
 #include <backend/webapi_backend.h>
 #include <backend/webapi_objects/webapi_media_objects.h>
+#include <fb2k/advanced_config.h>
 #include <fb2k/config.h>
 #include <fb2k/file_info_filler.h>
+#include <utils/pcm_conversion.h>
 
 #include <qwr/string_helpers.h>
 
+#include <chrono>
 #include <cstdint>
 #include <cstdlib>
 #include <fstream>
 #include <functional>
+#include <utility>
 #include <vector>
 
 using namespace std::literals::string_view_literals;
@@ -103,6 +107,16 @@ private:
     std::unordered_multimap<std::string, std::string> trackMeta_;
 
     bool isFirstBlock_ = false;
+    uint32_t coalescingInMs_{};
+    bool shouldLogPlaybackDebug_ = false;
+    std::chrono::steady_clock::time_point openTime_;
+    bool hasDecodedFirstSample_ = false;
+    /// How the track was started: used for logging only
+    std::string trackSwitchType_;
+    /// Position of the next sample to be returned by `decode_run`
+    uint64_t decodedFrames_ = 0;
+    std::optional<std::chrono::steady_clock::time_point> seekTime_;
+    bool isBufferedSeek_ = false;
     int channels_{};
     int sampleRate_{};
     int bitRate_{};
@@ -194,6 +208,7 @@ void InputSpotify::Finalize()
 void InputSpotify::open( service_ptr_t<file> m_file, const char* p_path, t_input_open_reason p_reason, abort_callback& p_abort )
 {
     openedReason_ = p_reason;
+    openTime_ = std::chrono::steady_clock::now();
 
     if ( p_reason == input_open_info_write )
     {
@@ -205,7 +220,7 @@ void InputSpotify::open( service_ptr_t<file> m_file, const char* p_path, t_input
     const auto spotifyObject = SpotifyFilteredTrack::Parse( p_path );
     trackId_ = spotifyObject.Id();
     const auto track = waBackend.GetTrack( trackId_, p_abort );
-    trackMeta_ = waBackend.GetMetaForTracks( nonstd::span<const std::unique_ptr<const WebApi_Track>>( &track, 1 ) )[0];
+    trackMeta_ = waBackend.GetMetaForTracks( nonstd::span<const std::shared_ptr<const WebApi_Track>>( &track, 1 ) )[0];
 
     if ( p_reason == input_open_info_read )
     { // don't use LibSpotify stuff if it's not needed
@@ -214,57 +229,8 @@ void InputSpotify::open( service_ptr_t<file> m_file, const char* p_path, t_input
 
     auto& lsBackend = GetInitializedLibSpotify();
 
-    auto pSession = lsBackend.GetInitializedSpSession( p_abort );
-
-    lsBackend.ExecSpMutex( [&] {
-        wrapper::Ptr<sp_link> link( sp_link_create_from_string( spotifyObject.ToUri().c_str() ) );
-        if ( !link )
-        {
-            throw exception_io_data( "Couldn't parse url" );
-        }
-
-        track_.Release();
-
-        switch ( sp_link_type( link ) )
-        {
-        case SP_LINKTYPE_TRACK:
-        {
-            track_ = sp_link_as_track( link );
-            break;
-        }
-        default:
-        {
-            throw exception_io_data( "Only track links should be passed to input" );
-        }
-        }
-    } );
-
-    while ( true )
-    {
-        // TODO: clean up here
-        const auto done = lsBackend.ExecSpMutex( [&] {
-            const auto sp = sp_track_error( track_ );
-            if ( SP_ERROR_OK == sp )
-            {
-                return true;
-            }
-            else if ( SP_ERROR_IS_LOADING == sp )
-            {
-                return false;
-            }
-            else
-            {
-                throw qwr::QwrException( fmt::format( "sp_track_error failed: {}", sp_error_message( sp ) ) );
-            }
-        } );
-
-        if ( done )
-        {
-            break;
-        }
-
-        p_abort.sleep( 0.05 );
-    }
+    lsBackend.GetInitializedSpSession( p_abort );
+    lsBackend.LoadTrack( spotifyObject.ToUri(), track_, p_abort );
 
     bitRate_ = [] {
         switch ( config::preferred_bitrate )
@@ -315,6 +281,8 @@ foobar2000_io::t_filestats InputSpotify::get_file_stats( abort_callback& p_abort
 void InputSpotify::decode_initialize( t_int32 subsong, unsigned p_flags, abort_callback& p_abort )
 {
     isFirstBlock_ = true;
+    decodedFrames_ = 0;
+    seekTime_.reset();
 
     if ( subsong )
     {
@@ -330,72 +298,141 @@ void InputSpotify::decode_initialize( t_int32 subsong, unsigned p_flags, abort_c
     lsBackend.AcquireDecoder( this );
     hasDecoder_ = true;
 
-    lsBackend.GetAudioBuffer().clear();
-    auto pSession = lsBackend.GetInitializedSpSession( p_abort );
+    coalescingInMs_ = config::advanced::playback_chunk_coalescing_in_ms.GetValue();
+    shouldLogPlaybackDebug_ = config::advanced::logging_playback_debug;
 
-    lsBackend.ExecSpMutex( [&] {
-        const auto sp = sp_session_player_load( pSession, track_ );
-        if ( sp != SP_ERROR_OK )
-        {
-            throw qwr::QwrException( fmt::format( "sp_session_player_load failed: {}", GetPlaybackErrorMessage( sp, trackId_, p_abort ) ) );
-        }
+    if ( lsBackend.AdoptPreloadedTrack( trackId_ ) )
+    { // track data is already in the buffer, right after the previous track
+        trackSwitchType_ = "preloaded";
+        return;
+    }
+    if ( shouldLogPlaybackDebug_ )
+    {
+        trackSwitchType_ = ( lsBackend.WasTrackPrefetched( trackId_ ) ? "prefetched" : "not prefetched" );
+    }
+
+    lsBackend.GetAudioBuffer().clear();
+    lsBackend.GetInitializedSpSession( p_abort );
 
-        sp_session_player_play( pSession, true );
-    } );
+    const auto sp = lsBackend.PlayTrack( trackId_, track_ );
+    if ( sp != SP_ERROR_OK )
+    {
+        throw qwr::QwrException( fmt::format( "sp_session_player_load failed: {}", GetPlaybackErrorMessage( sp, trackId_, p_abort ) ) );
+    }
 }
 
 bool InputSpotify::decode_run( audio_chunk& p_chunk, abort_callback& p_abort )
 {
-    bool isEof = false;
-    const auto dataReader = [&]( const AudioBuffer::AudioChunkHeader& header,
-                                 const uint16_t* data ) {
-        if ( header.eof )
-        {
-            isEof = true;
-            return;
-        }
-        channels_ = header.channels;
-        sampleRate_ = header.sampleRate;
-        p_chunk.set_data_fixedpoint( data,
-                                     header.size * sizeof( uint16_t ),
-                                     header.sampleRate,
-                                     header.channels,
-                                     16,
-                                     audio_chunk::channel_config_stereo );
-    };
-
     auto& lsBackend = GetInitializedLibSpotify();
     auto& buf = lsBackend.GetAudioBuffer();
 
-    if ( !buf.read( dataReader ) )
+    auto chunkOpt = buf.peek();
+    if ( !chunkOpt )
     {
-        buf.wait_for_data( p_abort );
-        if ( !buf.read( dataReader ) )
-        { // wait was aborted, ending playback
-            isEof = true;
+        if ( hasDecodedFirstSample_ && !seekTime_ )
+        { // initial buffering and seeks are not underruns
+            buf.report_underrun();
+            if ( shouldLogPlaybackDebug_ )
+            {
+                FB2K_console_formatter() << SPTF_UNDERSCORE_NAME " (debug):\n"
+                                         << "audio buffer underrun";
+            }
         }
+        buf.wait_for_data( p_abort );
+        chunkOpt = buf.peek();
     }
 
-    if ( isEof )
-    {
+    if ( !chunkOpt || chunkOpt->header.eof )
+    { // wait was aborted or track has ended
+        if ( chunkOpt )
+        {
+            buf.commit_read();
+        }
         lsBackend.ReleaseDecoder( this );
         hasDecoder_ = false;
         return false;
     }
 
+    // data is converted straight from the buffer memory:
+    // producer won't touch it until the read is committed
+    const auto header = chunkOpt->header;
+    channels_ = header.channels;
+    sampleRate_ = header.sampleRate;
+
+    const auto targetSize = std::max<size_t>( chunkOpt->data.size(),
+                                              static_cast<uint64_t>( coalescingInMs_ ) * header.sampleRate / 1000 * header.channels );
+    p_chunk.set_data_size( targetSize );
+
+    size_t curSize = 0;
+    do
+    {
+        const auto data = chunkOpt->data;
+        pcm::ConvertInt16ToFloat( reinterpret_cast<const int16_t*>( data.data() ), p_chunk.get_data() + curSize, data.size() );
+        curSize += data.size();
+        buf.commit_read();
+
+        // format change and eof must not be merged: they are handled by the next call
+        chunkOpt = buf.peek();
+    } while ( chunkOpt
+              && !chunkOpt->header.eof
+              && chunkOpt->header.sampleRate == header.sampleRate
+              && chunkOpt->header.channels == header.channels
+              && curSize + chunkOpt->data.size() <= targetSize );
+
+    p_chunk.set_sample_count( curSize / header.channels );
+    p_chunk.set_srate( header.sampleRate );
+    p_chunk.set_channels( header.channels, audio_chunk::channel_config_stereo );
+
+    decodedFrames_ += curSize / header.channels;
+
+    if ( !hasDecodedFirstSample_ )
+    {
+        hasDecodedFirstSample_ = true;
+        if ( shouldLogPlaybackDebug_ )
+        {
+            const auto timeToFirstSample = std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now() - openTime_ );
+            FB2K_console_formatter() << SPTF_UNDERSCORE_NAME " (debug):\n"
+                                     << fmt::format( "time to first sample: {} ms ({})", timeToFirstSample.count(), trackSwitchType_ );
+        }
+    }
+
+    if ( seekTime_ )
+    {
+        if ( shouldLogPlaybackDebug_ )
+        {
+            const auto seekLatency = std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now() - *seekTime_ );
+            FB2K_console_formatter() << SPTF_UNDERSCORE_NAME " (debug):\n"
+                                     << fmt::format( "seek latency: {} ms ({})", seekLatency.count(), isBufferedSeek_ ? "buffered" : "libspotify" );
+        }
+        seekTime_.reset();
+    }
+
     return true;
 }
 
 void InputSpotify::decode_seek( double p_seconds, abort_callback& p_abort )
 {
     isFirstBlock_ = true;
+    seekTime_ = std::chrono::steady_clock::now();
 
     auto& lsBackend = GetInitializedLibSpotify();
-    lsBackend.GetAudioBuffer().clear();
-    auto pSession = lsBackend.GetInitializedSpSession( p_abort );
-    lsBackend.ExecSpMutex( [&] {
-        sp_session_player_seek( pSession, static_cast<int>( p_seconds * 1000 ) );
-    } );
+    auto& buf = lsBackend.GetAudioBuffer();
+
+    const auto targetFrame = static_cast<uint64_t>( p_seconds * sampleRate_ );
+    const auto decodedFrames = std::exchange( decodedFrames_, targetFrame );
+
+    // forward seek within the buffered data does not need a round-trip to libspotify
+    isBufferedSeek_ = ( sampleRate_ && channels_
+                        && targetFrame >= decodedFrames
+                        && buf.skip( static_cast<size_t>( targetFrame - decodedFrames ) * channels_ ) );
+    if ( isBufferedSeek_ )
+    {
+        return;
+    }
+
+    buf.clear();
+    lsBackend.GetInitializedSpSession( p_abort );
+    lsBackend.SeekTrack( trackId_, track_, static_cast<int>( p_seconds * 1000 ) );
 }
 
 bool InputSpotify::decode_can_seek()
@@ -3,12 +3,117 @@
 #include "playback.h"
 
 #include <backend/libspotify_backend.h>
+#include <backend/libspotify_wrapper.h>
+#include <backend/spotify_instance.h>
+#include <backend/spotify_object.h>
+#include <backend/webapi_backend.h>
+#include <backend/webapi_objects/webapi_media_objects.h>
+#include <fb2k/advanced_config.h>
+
+#include <qwr/final_action.h>
+#include <qwr/thread_pool.h>
+
+#include <optional>
+
+using namespace sptf;
+
+namespace
+{
+
+std::optional<std::string> GetSpotifyTrackId( metadb_handle_ptr pTrack )
+{
+    if ( !pTrack )
+    {
+        return std::nullopt;
+    }
+
+    const char* path = pTrack->get_location().get_path();
+    if ( !SpotifyFilteredTrack::IsValid( path, false ) )
+    {
+        return std::nullopt;
+    }
+
+    return SpotifyFilteredTrack::Parse( path ).Id();
+}
+
+/// @return track that will be played next, if it can be predicted
+metadb_handle_ptr GetNextTrack()
+{
+    auto pc = playback_control::get();
+    if ( pc->get_stop_after_current() )
+    {
+        return nullptr;
+    }
+
+    auto plm = playlist_manager::get();
+
+    pfc::list_t<t_playback_queue_item> queue;
+    plm->queue_get_contents( queue );
+    if ( queue.get_count() )
+    {
+        return queue[0].m_handle;
+    }
+
+    t_size playlistIdx = 0;
+    t_size itemIdx = 0;
+    if ( !plm->get_playing_item_location( &playlistIdx, &itemIdx ) )
+    {
+        return nullptr;
+    }
+
+    const auto itemCount = plm->playlist_get_item_count( playlistIdx );
+    const auto nextItemIdx = [&]() -> std::optional<t_size> {
+        // see `playlist_manager::playback_order_get_name`
+        switch ( plm->playback_order_get_active() )
+        {
+        case 0: // Default
+        {
+            if ( itemIdx + 1 >= itemCount )
+            {
+                return std::nullopt;
+            }
+            return itemIdx + 1;
+        }
+        case 1: // Repeat (playlist)
+        {
+            return ( itemIdx + 1 ) % itemCount;
+        }
+        case 2: // Repeat (track)
+        {
+            return itemIdx;
+        }
+        default:
+        { // random orders can't be predicted
+            return std::nullopt;
+        }
+        }
+    }();
+
+    if ( !nextItemIdx )
+    {
+        return nullptr;
+    }
+
+    metadb_handle_ptr pNextTrack;
+    if ( !plm->playlist_get_item_handle( pNextTrack, playlistIdx, *nextItemIdx ) )
+    {
+        return nullptr;
+    }
+
+    return pNextTrack;
+}
+
+} // namespace
 
 namespace sptf::fb2k
 {
 
 std::mutex PlayCallbacks::mutex_;
 LibSpotify_Backend* PlayCallbacks::pLsBackend_ = nullptr;
+std::shared_ptr<abort_callback_impl> PlayCallbacks::pPreloadAbort_;
+size_t PlayCallbacks::preloadTaskCount_ = 0;
+std::condition_variable PlayCallbacks::preloadTaskCv_;
+std::optional<double> PlayCallbacks::prefetchTimeOpt_;
 
 PlayCallbacks::PlayCallbacks()
 {
@@ -26,13 +131,16 @@ void PlayCallbacks::Initialize( LibSpotify_Backend& lsBackend )
 
 void PlayCallbacks::Finalize()
 {
-    std::lock_guard lg( mutex_ );
+    std::unique_lock ul( mutex_ );
+    CancelPreload_NonBlocking();
+    // preload task uses backend directly
+    preloadTaskCv_.wait( ul, [] { return !preloadTaskCount_; } );
     pLsBackend_ = nullptr;
 }
 
 unsigned PlayCallbacks::get_flags()
 {
-    return ( flag_on_playback_stop | flag_on_playback_pause );
+    return ( flag_on_playback_stop | flag_on_playback_pause | flag_on_playback_new_track | flag_on_playback_time );
 }
 
 void PlayCallbacks::on_playback_pause( bool isPaused )
@@ -44,8 +152,9 @@ void PlayCallbacks::on_playback_pause( bool isPaused )
         return;
     }
 
+    // no need to wait for the result
     auto pSession = pLsBackend_->GetWhateverSpSession();
-    pLsBackend_->ExecSpMutex( [&] {
+    pLsBackend_->ExecSpAsync( [pSession, isPaused] {
         sp_session_player_play( pSession, !isPaused );
     } );
 }
@@ -64,10 +173,104 @@ void PlayCallbacks::on_playback_stop( play_control::t_stop_reason reason )
         return;
     }
 
-    auto pSession = pLsBackend_->GetWhateverSpSession();
-    pLsBackend_->ExecSpMutex( [&] {
-        sp_session_player_unload( pSession );
+    CancelPreload_NonBlocking();
+    pLsBackend_->UnloadTrack();
+}
+
+void PlayCallbacks::on_playback_new_track( metadb_handle_ptr p_track )
+{
+    std::lock_guard lg( mutex_ );
+
+    if ( !pLsBackend_ )
+    {
+        return;
+    }
+
+    CancelPreload_NonBlocking();
+    PreloadNextTrack_NonBlocking( p_track );
+}
+
+void PlayCallbacks::on_playback_time( double p_time )
+{
+    std::lock_guard lg( mutex_ );
+
+    if ( !pLsBackend_ || !prefetchTimeOpt_ || p_time < *prefetchTimeOpt_ )
+    {
+        return;
+    }
+
+    prefetchTimeOpt_.reset();
+    pLsBackend_->PrefetchQueuedTrack();
+}
+
+void PlayCallbacks::PreloadNextTrack_NonBlocking( metadb_handle_ptr pTrack )
+{
+    const auto curTrackIdOpt = GetSpotifyTrackId( pTrack );
+    if ( !curTrackIdOpt )
+    {
+        return;
+    }
+
+    const auto nextTrackIdOpt = GetSpotifyTrackId( GetNextTrack() );
+    if ( !nextTrackIdOpt )
+    {
+        return;
+    }
+
+    auto pAbort = std::make_shared<abort_callback_impl>();
+    pPreloadAbort_ = pAbort;
+
+    if ( const auto prefetchBeforeEnd = config::advanced::playback_prefetch_before_end_in_s.GetValue();
+         prefetchBeforeEnd )
+    { // prefetch is started by `on_playback_time`, since the next track needs to be resolved first anyway
+        prefetchTimeOpt_ = std::max( 0.0, pTrack->get_length() - prefetchBeforeEnd );
+    }
+
+    // backends are retrieved beforehand: `SpotifyInstance` can't be accessed from the task,
+    // since it's locked while `Finalize` waits for the task
+    auto& waBackend = SpotifyInstance::Get().GetWebApi_Backend();
+    auto& threadPool = SpotifyInstance::Get().GetThreadPool();
+    threadPool.AddTask( [pAbort, &waBackend, &lsBackend = *pLsBackend_, curTrackId = *curTrackIdOpt, nextTrackId = *nextTrackIdOpt] {
+        const qwr::final_action autoComplete( [] {
+            std::lock_guard lg( mutex_ );
+            --preloadTaskCount_;
+            preloadTaskCv_.notify_all();
+        } );
+
+        try
+        {
+            // warm up the cache for `InputSpotify::open`
+            (void)waBackend.GetTrack( nextTrackId, *pAbort );
+
+            wrapper::Ptr<sp_track> track;
+            const qwr::final_action autoRelease( [&] {
+                lsBackend.ExecSpMutex( [&] { track.Release(); } );
+            } );
+            lsBackend.LoadTrack( SpotifyFilteredTrack( nextTrackId ).ToUri(), track, *pAbort );
+            lsBackend.QueueNextTrack( curTrackId, nextTrackId, track, *pAbort );
+        }
+        catch ( const std::exception& )
+        { // preload is optional: track will be loaded as usual when opened
+        }
     } );
+    // incremented after `AddTask`, since it might throw: task can't finish earlier anyway, since `mutex_` is held
+    ++preloadTaskCount_;
+}
+
+void PlayCallbacks::CancelPreload_NonBlocking()
+{
+    prefetchTimeOpt_.reset();
+    if ( !pPreloadAbort_ )
+    {
+        return;
+    }
+
+    pPreloadAbort_->abort();
+    pPreloadAbort_.reset();
+    if ( pLsBackend_ )
+    {
+        pLsBackend_->CancelPreload();
+    }
 }
 
 } // namespace sptf::fb2k
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <condition_variable>
+#include <memory>
 #include <mutex>
+#include <optional>
 
 namespace sptf
 {
@@ -26,19 +29,30 @@ public:
     unsigned get_flags() override;
     void on_playback_pause( bool isPaused ) override;
     void on_playback_stop( play_control::t_stop_reason reason ) override;
+    void on_playback_new_track( metadb_handle_ptr p_track ) override;
+    void on_playback_time( double p_time ) override;
 
     void on_playback_starting( play_control::t_track_command p_command, bool p_paused ) override{};
-    void on_playback_new_track( metadb_handle_ptr p_track ) override{};
     void on_playback_seek( double p_time ) override{};
     void on_playback_edited( metadb_handle_ptr p_track ) override{};
     void on_playback_dynamic_info( const file_info& p_info ) override{};
     void on_playback_dynamic_info_track( const file_info& p_info ) override{};
-    void on_playback_time( double p_time ) override{};
     void on_volume_change( float p_new_val ) override{};
 
+private:
+    /// Resolves the track that will be played after `pTrack` and queues it for gapless playback
+    static void PreloadNextTrack_NonBlocking( metadb_handle_ptr pTrack );
+    static void CancelPreload_NonBlocking();
+
 private:
     static std::mutex mutex_;
     static LibSpotify_Backend* pLsBackend_;
+    static std::shared_ptr<abort_callback_impl> pPreloadAbort_;
+    /// Number of running preload tasks: backend must not be finalized until they are done
+    static size_t preloadTaskCount_;
+    static std::condition_variable preloadTaskCv_;
+    /// Playback time of the current track at which the next track should be prefetched
+    static std::optional<double> prefetchTimeOpt_;
 };
 
 } // namespace sptf::fb2k
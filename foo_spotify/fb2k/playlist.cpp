@@ -6,7 +6,6 @@
 #include <backend/webapi_objects/webapi_media_objects.h>
 
 #include <qwr/abort_callback.h>
-#include <qwr/thread_pool.h>
 
 using namespace sptf;
 
@@ -110,32 +109,35 @@ void PlaylistCallbackSpotify::on_playlist_activate( t_size p_old, t_size p_new )
         return;
     }
 
-    auto& threadPool = SpotifyInstance::Get().GetThreadPool();
-    threadPool.AddTask( [trackIds = std::move( trackIds )] {
-        try
-        {
-            auto& waBackend = SpotifyInstance::Get().GetWebApi_Backend();
-
-            // pre-cache tracks
-            qwr::TimedAbortCallback tac1;
-            const auto tracks = waBackend.GetTracks( trackIds, tac1 );
-
-            const auto artistIds =
+    // requests are not blocking, so worker threads are not occupied while pre-caching
+    auto pAbort = std::make_shared<qwr::TimedAbortCallback>();
+    pplx::create_task( [pAbort, trackIds = std::move( trackIds )]() mutable {
+        // pre-cache tracks
+        auto& waBackend = SpotifyInstance::Get().GetWebApi_Backend();
+        return waBackend.GetTracksAsync( std::move( trackIds ), *pAbort );
+    } )
+        .then( [pAbort]( std::vector<std::shared_ptr<const WebApi_Track>> tracks ) {
+            auto artistIds =
                 tracks
                 | ranges::views::transform( []( const auto& pTrack ) -> std::string { return pTrack->artists[0]->id; } )
                 | ranges::to_vector;
 
             // pre-cache artists
-            qwr::TimedAbortCallback tac2;
-            waBackend.RefreshCacheForArtists( artistIds, tac2 );
-        }
-        catch ( const std::exception& e )
-        {
-            FB2K_console_formatter() << SPTF_UNDERSCORE_NAME " (error):\n"
-                                     << "Failed to refresh tracks:\n"
-                                     << e.what();
-        }
-    } );
+            auto& waBackend = SpotifyInstance::Get().GetWebApi_Backend();
+            return waBackend.RefreshCacheForArtistsAsync( std::move( artistIds ), *pAbort );
+        } )
+        .then( [pAbort]( pplx::task<void> task ) {
+            try
+            {
+                task.get();
+            }
+            catch ( const std::exception& e )
+            {
+                FB2K_console_formatter() << SPTF_UNDERSCORE_NAME " (error):\n"
+                                         << "Failed to refresh tracks:\n"
+                                         << e.what();
+            }
+        } );
 }
 
 } // namespace
@@ -97,7 +97,7 @@ struct SkippedTrack
 };
 
 std::vector<SkippedTrack>
-TransformToSkippedTracks( nonstd::span<const std::unique_ptr<const WebApi_LocalTrack>> tracks )
+TransformToSkippedTracks( nonstd::span<const std::shared_ptr<const WebApi_LocalTrack>> tracks )
 {
     return ranges::views::transform( tracks,
                                      [&]( const auto& pTrack ) -> SkippedTrack {
@@ -106,7 +106,7 @@ TransformToSkippedTracks( nonstd::span<const std::unique_ptr<const WebApi_LocalT
            | ranges::to_vector;
 }
 
-std::tuple<std::vector<std::unique_ptr<const sptf::WebApi_Track>>, std::vector<SkippedTrack>>
+std::tuple<std::vector<std::shared_ptr<const sptf::WebApi_Track>>, std::vector<SkippedTrack>>
 GetTracks( const SpotifyObject spotifyObject, abort_callback& p_abort )
 {
     auto& waBackend = SpotifyInstance::Get().GetWebApi_Backend();
@@ -141,7 +141,7 @@ GetTracks( const SpotifyObject spotifyObject, abort_callback& p_abort )
     }
     else if ( spotifyObject.type == "track" )
     {
-        std::vector<std::unique_ptr<const WebApi_Track>> tmp;
+        std::vector<std::shared_ptr<const WebApi_Track>> tmp;
         tmp.emplace_back( waBackend.GetTrack( spotifyObject.id, p_abort ) );
 
         return { std::move( tmp ), std::vector<SkippedTrack>{} };
@@ -151,7 +151,7 @@ GetTracks( const SpotifyObject spotifyObject, abort_callback& p_abort )
         std::vector<SkippedTrack> tmp;
         tmp.emplace_back( SkippedTrack{ spotifyObject.id, "local track" } );
 
-        return { std::vector<std::unique_ptr<const sptf::WebApi_Track>>{}, tmp };
+        return { std::vector<std::shared_ptr<const sptf::WebApi_Track>>{}, tmp };
     }
     else
     {
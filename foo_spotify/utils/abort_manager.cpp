@@ -3,43 +3,160 @@
 #include "abort_manager.h"
 
 #include <qwr/thread_helpers.h>
+#include <qwr/winapi_error_helpers.h>
+
+namespace
+{
+
+/// Used when abort events can't be waited for directly
+constexpr DWORD kPollPeriodInMs = 50;
+/// Abort callback might be signaled without setting its event,
+/// so `is_aborting` is still checked periodically, even when waiting for events
+constexpr DWORD kMaxWaitPeriodInMs = 250;
+
+} // namespace
 
 namespace sptf
 {
 
 AbortManager::AbortManager()
 {
+    // auto-reset: a single wake up is enough to rescan all callbacks
+    hWakeEvent_ = CreateEvent( nullptr, FALSE, FALSE, nullptr );
+    qwr::error::CheckWinApi( hWakeEvent_ != nullptr, "CreateEvent" );
+
     StartThread();
 }
 
+AbortManager::~AbortManager()
+{
+    StopThread();
+
+    for ( const auto& entry: entries_ )
+    {
+        if ( entry.hAbortEvent )
+        {
+            CloseHandle( entry.hAbortEvent );
+        }
+    }
+    CloseRemovedEvents_NonBlocking();
+    CloseHandle( hWakeEvent_ );
+}
+
 void AbortManager::Finalize()
 {
     StopThread();
 }
 
-void AbortManager::RemoveTask( uint32_t taskId )
+void AbortManager::AddScope( AbortableScopeBase& scope )
 {
-    std::unique_lock lock( mutex_ );
+    bool shouldWake = false;
+    {
+        std::lock_guard lock( mutex_ );
 
-    const auto itTask = idToTask_.find( taskId );
-    assert( itTask != idToTask_.cend() );
-    const auto pAbort = itTask->second.pAbort;
-    idToTask_.erase( itTask );
+        bool isNew = false;
+        const auto entryIdx = AcquireEntry_NonBlocking( scope.abort_, isNew );
+        auto& entry = entries_[entryIdx];
 
-    const auto itIds = abortToIds_.find( pAbort );
-    assert( itIds != abortToIds_.cend() );
-    auto& ids = itIds->second;
+        scope.entryIdx_ = entryIdx;
+        scope.pNext_ = entry.pFirstScope;
+        if ( entry.pFirstScope )
+        {
+            entry.pFirstScope->pPrev_ = &scope;
+        }
+        entry.pFirstScope = &scope;
 
-    const auto itId = std::find( ids.rbegin(), ids.rend(), taskId );
-    assert( itId != ids.rend() );
+        // wait set needs to be updated or the task needs to be invoked right away
+        shouldWake = ( isNew || scope.abort_.is_aborting() );
+    }
 
-    ids.erase( std::next( itId ).base() );
-    if ( ids.empty() )
+    if ( shouldWake )
+    {
+        SetEvent( hWakeEvent_ );
+    }
+}
+
+void AbortManager::RemoveScope( AbortableScopeBase& scope )
+{
+    bool shouldWake = false;
     {
-        abortToIds_.erase( itIds );
+        std::lock_guard lock( mutex_ );
+
+        auto& entry = entries_[scope.entryIdx_];
+        assert( entry.pAbort == &scope.abort_ );
+
+        if ( scope.pPrev_ )
+        {
+            scope.pPrev_->pNext_ = scope.pNext_;
+        }
+        else
+        {
+            assert( entry.pFirstScope == &scope );
+            entry.pFirstScope = scope.pNext_;
+        }
+        if ( scope.pNext_ )
+        {
+            scope.pNext_->pPrev_ = scope.pPrev_;
+        }
+
+        if ( !entry.pFirstScope )
+        {
+            ReleaseEntry_NonBlocking( scope.entryIdx_ );
+            // event loop should stop waiting for this event
+            shouldWake = true;
+        }
     }
 
-    assert( abortToIds_.size() <= idToTask_.size() );
+    if ( shouldWake )
+    {
+        SetEvent( hWakeEvent_ );
+    }
+}
+
+size_t AbortManager::AcquireEntry_NonBlocking( abort_callback& abort, bool& isNew )
+{
+    // the number of concurrently used abort callbacks is small, so linear search is faster than a map
+    for ( size_t i = 0; i < entries_.size(); ++i )
+    {
+        if ( entries_[i].pAbort == &abort )
+        {
+            isNew = false;
+            return i;
+        }
+    }
+
+    const auto entryIdx = [&] {
+        if ( freeEntryIdxs_.empty() )
+        {
+            entries_.emplace_back();
+            return entries_.size() - 1;
+        }
+
+        const auto idx = freeEntryIdxs_.back();
+        freeEntryIdxs_.pop_back();
+        return idx;
+    }();
+
+    auto& entry = entries_[entryIdx];
+    entry.pAbort = &abort;
+    entry.pFirstScope = nullptr;
+    entry.hAbortEvent = DuplicateAbortEvent( abort );
+
+    isNew = true;
+    return entryIdx;
+}
+
+void AbortManager::ReleaseEntry_NonBlocking( size_t entryIdx )
+{
+    auto& entry = entries_[entryIdx];
+    assert( !entry.pFirstScope );
+
+    if ( entry.hAbortEvent )
+    {
+        eventsToClose_.emplace_back( entry.hAbortEvent );
+    }
+    entry = AbortEntry{};
+    freeEntryIdxs_.emplace_back( entryIdx );
 }
 
 void AbortManager::StartThread()
@@ -59,7 +176,7 @@ void AbortManager::StopThread()
         std::unique_lock lock( mutex_ );
         isTimeToDie_ = true;
     }
-    eventCv_.notify_all();
+    SetEvent( hWakeEvent_ );
 
     if ( pThread_->joinable() )
     {
@@ -71,58 +188,118 @@ void AbortManager::StopThread()
 
 void AbortManager::EventLoop()
 {
+    std::vector<HANDLE> handles;
     while ( true )
     {
-        std::unique_lock lock( mutex_ );
-
-        do
+        bool shouldPoll = false;
         {
-            eventCv_.wait_for( lock, std::chrono::seconds( 2 ) );
-        } while ( !isTimeToDie_ && abortToIds_.empty() );
+            std::unique_lock lock( mutex_ );
 
-        if ( isTimeToDie_ )
-        {
-            for ( auto& [id, task]: idToTask_ )
+            CloseRemovedEvents_NonBlocking();
+
+            if ( isTimeToDie_ )
             {
-                std::invoke( *( task.task ) );
+                for ( const auto& entry: entries_ )
+                {
+                    for ( auto pScope = entry.pFirstScope; pScope; pScope = pScope->pNext_ )
+                    {
+                        pScope->pInvoke_( *pScope );
+                    }
+                }
+                return;
             }
-            return;
-        }
 
-        for ( const auto& [pAbort, ids]: abortToIds_ )
-        {
-            if ( pAbort->is_aborting() )
+            InvokeAbortedTasks_NonBlocking();
+
+            handles.clear();
+            handles.emplace_back( hWakeEvent_ );
+            for ( const auto& entry: entries_ )
             {
-                for ( const auto& id: ranges::views::reverse( ids ) )
+                if ( !entry.pAbort || entry.pAbort->is_aborting() )
+                { // free entry or tasks were invoked above (new ones will wake us up)
+                    continue;
+                }
+
+                if ( !entry.hAbortEvent )
                 {
-                    assert( idToTask_.count( id ) );
-                    std::invoke( *( idToTask_[id].task ) );
+                    shouldPoll = true;
+                    continue;
                 }
+                handles.emplace_back( entry.hAbortEvent );
             }
+            shouldPoll |= ( handles.size() > MAXIMUM_WAIT_OBJECTS );
+        }
+
+        if ( shouldPoll )
+        {
+            WaitForSingleObject( hWakeEvent_, kPollPeriodInMs );
+            continue;
+        }
+
+        // no need to wake up periodically, if there is nothing to check
+        const auto timeout = ( handles.size() > 1 ? kMaxWaitPeriodInMs : INFINITE );
+        const auto ret = WaitForMultipleObjects( static_cast<DWORD>( handles.size() ), handles.data(), FALSE, timeout );
+        if ( ret == WAIT_FAILED )
+        { // should not happen, but it's better to degrade to polling than to spin
+            WaitForSingleObject( hWakeEvent_, kPollPeriodInMs );
         }
     }
 }
 
-AbortManager::AbortableScope::AbortableScope( size_t taskId, AbortManager& parent )
-    : parent_( parent )
-    , taskId_( taskId )
+void AbortManager::InvokeAbortedTasks_NonBlocking()
 {
+    for ( const auto& entry: entries_ )
+    {
+        if ( !entry.pAbort || !entry.pAbort->is_aborting() )
+        {
+            continue;
+        }
+
+        for ( auto pScope = entry.pFirstScope; pScope; pScope = pScope->pNext_ )
+        {
+            if ( pScope->isInvoked_ )
+            {
+                continue;
+            }
+
+            pScope->isInvoked_ = true;
+            pScope->pInvoke_( *pScope );
+        }
+    }
 }
 
-AbortManager::AbortableScope::AbortableScope( AbortableScope&& other )
-    : parent_( other.parent_ )
-    , isValid_( other.isValid_ )
-    , taskId_( other.taskId_ )
+void AbortManager::CloseRemovedEvents_NonBlocking()
 {
-    other.isValid_ = false;
+    for ( auto hEvent: eventsToClose_ )
+    {
+        CloseHandle( hEvent );
+    }
+    eventsToClose_.clear();
 }
 
-AbortManager::AbortableScope::~AbortableScope()
+HANDLE AbortManager::DuplicateAbortEvent( abort_callback& abort )
 {
-    if ( isValid_ )
+    const auto hEvent = abort.get_abort_event();
+    if ( !hEvent )
     {
-        parent_.RemoveTask( taskId_ );
+        return nullptr;
+    }
+
+    HANDLE hDuplicate = nullptr;
+    const auto bRet = DuplicateHandle( GetCurrentProcess(), hEvent, GetCurrentProcess(), &hDuplicate, SYNCHRONIZE, FALSE, 0 );
+    if ( !bRet )
+    { // callback will be polled instead
+        return nullptr;
     }
+
+    return hDuplicate;
+}
+
+AbortManager::AbortableScopeBase::AbortableScopeBase( AbortManager& parent, abort_callback& abort, InvokeFn pInvoke )
+    : parent_( parent )
+    , abort_( abort )
+    , pInvoke_( pInvoke )
+{
 }
 
 } // namespace sptf
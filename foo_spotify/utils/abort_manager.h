@@ -1,111 +1,138 @@
 #pragma once
 
-#include <condition_variable>
 #include <functional>
 #include <mutex>
+#include <type_traits>
+#include <vector>
 
 namespace sptf
 {
 
+/// Invokes registered tasks when the corresponding abort callback is signaled.
+/// Abort events are waited for directly, with a fallback to polling when there are
+/// too many of them for a single wait. Callbacks are also re-checked periodically,
+/// since not all of them set their event when signaled.
 class AbortManager
 {
-private:
-    using Task = std::function<void()>;
-
-    struct AbortableTask
+public:
+    /// Intrusive list node: lives on the caller's stack, so that registration does not allocate.
+    class AbortableScopeBase
     {
-        std::unique_ptr<Task> task;
-        abort_callback* pAbort;
+        friend class AbortManager;
+
+    public:
+        AbortableScopeBase( const AbortableScopeBase& ) = delete;
+        AbortableScopeBase& operator=( const AbortableScopeBase& ) = delete;
+
+    protected:
+        using InvokeFn = void ( * )( AbortableScopeBase& scope );
+
+        AbortableScopeBase( AbortManager& parent, abort_callback& abort, InvokeFn pInvoke );
+        ~AbortableScopeBase() = default;
+
+    protected:
+        AbortManager& parent_;
+
+    private:
+        abort_callback& abort_;
+        const InvokeFn pInvoke_;
+
+        // guarded by parent's mutex
+        size_t entryIdx_ = 0;
+        AbortableScopeBase* pPrev_ = nullptr;
+        AbortableScopeBase* pNext_ = nullptr;
+        bool isInvoked_ = false;
     };
 
-public:
-    class AbortableScope
+    /// Task is invoked from the abort manager thread, while the manager's lock is held:
+    /// so scopes must not be created or destroyed while holding a lock that is used in the task.
+    template <typename T>
+    class AbortableScope final : public AbortableScopeBase
     {
         friend class AbortManager;
 
     public:
-        AbortableScope( AbortableScope&& other );
-        ~AbortableScope();
+        ~AbortableScope()
+        { // must be unregistered before the task is destroyed
+            parent_.RemoveScope( *this );
+        }
 
     private:
-        AbortableScope( size_t taskId, AbortManager& parent );
+        template <typename U>
+        AbortableScope( AbortManager& parent, U&& task, abort_callback& abort )
+            : AbortableScopeBase( parent, abort, &Invoke )
+            , task_( std::forward<U>( task ) )
+        {
+            parent_.AddScope( *this );
+        }
+
+        static void Invoke( AbortableScopeBase& scope )
+        {
+            std::invoke( static_cast<AbortableScope&>( scope ).task_ );
+        }
 
     private:
-        AbortManager& parent_;
-        bool isValid_ = true;
-        size_t taskId_;
+        T task_;
     };
 
 public:
     AbortManager();
     AbortManager( const AbortManager& other ) = delete;
     AbortManager( AbortManager&& other ) = delete;
-    ~AbortManager() = default;
+    ~AbortManager();
 
     void Finalize();
 
     template <typename T>
-    AbortableScope GetAbortableScope( T&& task, abort_callback& abort )
+    [[nodiscard]] AbortableScope<std::decay_t<T>> GetAbortableScope( T&& task, abort_callback& abort )
     {
-        return AbortableScope( AddTask( std::forward<T>( task ), abort ), *this );
+        static_assert( std::is_invocable_v<std::decay_t<T>&> );
+
+        // guaranteed copy elision: scope is constructed in-place in the caller's frame
+        return AbortableScope<std::decay_t<T>>( *this, std::forward<T>( task ), abort );
     }
 
+private:
+    struct AbortEntry
+    {
+        /// nullptr if the entry is free
+        abort_callback* pAbort = nullptr;
+        /// Most recently registered scope first
+        AbortableScopeBase* pFirstScope = nullptr;
+        /// Owned duplicate of the abort event: abort callback might be destroyed before the wait is finished.
+        /// Might be null, in which case the callback is polled.
+        HANDLE hAbortEvent = nullptr;
+    };
+
 private:
     void StartThread();
     void StopThread();
 
     void EventLoop();
+    void InvokeAbortedTasks_NonBlocking();
+    void CloseRemovedEvents_NonBlocking();
 
-    template <typename T>
-    size_t AddTask( T&& task, abort_callback& abort )
-    {
-        static_assert( std::is_invocable_v<T> );
-        static_assert( std::is_move_constructible_v<T> || std::is_copy_constructible_v<T> );
-
-        const auto taskId = [&] {
-            std::unique_lock lock( mutex_ );
-
-            const auto taskId = [&] {
-                auto id = idCounter_;
-                while ( idToTask_.count( id ) )
-                {
-                    id = ++idCounter_;
-                }
-                return id;
-            }();
-
-            if constexpr ( !std::is_copy_constructible_v<T> && std::is_move_constructible_v<T> )
-            {
-                auto taskLambda = [taskWrapper = std::make_shared<T>( std::forward<T>( task ) )] {
-                    std::invoke( *taskWrapper );
-                };
-                idToTask_.try_emplace( taskId, AbortableTask{ std::make_unique<Task>( taskLambda ), &abort } );
-            }
-            else
-            {
-                idToTask_.try_emplace( taskId, AbortableTask{ std::make_unique<Task>( std::forward<T>( task ) ), &abort } );
-            }
-
-            return abortToIds_[&abort].emplace_back( taskId );
-        }();
-
-        eventCv_.notify_all();
-
-        return taskId;
-    }
+    void AddScope( AbortableScopeBase& scope );
+    void RemoveScope( AbortableScopeBase& scope );
+
+    /// @return index of the entry for the callback, a new one is created if needed
+    size_t AcquireEntry_NonBlocking( abort_callback& abort, bool& isNew );
+    void ReleaseEntry_NonBlocking( size_t entryIdx );
 
-    void RemoveTask( uint32_t taskId );
+    static HANDLE DuplicateAbortEvent( abort_callback& abort );
 
 private:
     std::unique_ptr<std::thread> pThread_;
 
     std::mutex mutex_;
-    std::condition_variable eventCv_;
+    HANDLE hWakeEvent_ = nullptr;
     bool isTimeToDie_ = false;
 
-    size_t idCounter_ = 0;
-    std::unordered_map<size_t, AbortableTask> idToTask_;
-    std::unordered_map<abort_callback*, std::vector<size_t>> abortToIds_;
+    /// Entries are reused, so that the pool does not grow beyond the peak number of active abort callbacks
+    std::vector<AbortEntry> entries_;
+    std::vector<size_t> freeEntryIdxs_;
+    /// Events can't be closed while event loop might be waiting for them
+    std::vector<HANDLE> eventsToClose_;
 };
 
 } // namespace sptf
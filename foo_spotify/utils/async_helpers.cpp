@@ -0,0 +1,65 @@
+#include <stdafx.h>
+
+#include "async_helpers.h"
+
+#include <utils/abort_manager.h>
+
+#include <pplawait.h>
+
+#include <qwr/winapi_error_helpers.h>
+
+#include <memory>
+
+#include <experimental/resumable>
+
+namespace sptf
+{
+
+pplx::task<void> DelayAsync( std::chrono::milliseconds delay )
+{
+    using EventT = pplx::task_completion_event<void>;
+
+    EventT event;
+    auto pEvent = std::make_unique<EventT>( event );
+
+    const auto pTimer = CreateThreadpoolTimer(
+        []( PTP_CALLBACK_INSTANCE, PVOID pContext, PTP_TIMER pTimer ) {
+            std::unique_ptr<EventT> pEvent( static_cast<EventT*>( pContext ) );
+            pEvent->set();
+            // one-shot timer: it's safe to close it from its own callback
+            CloseThreadpoolTimer( pTimer );
+        },
+        pEvent.get(),
+        nullptr );
+    qwr::error::CheckWinApi( pTimer != nullptr, "CreateThreadpoolTimer" );
+    pEvent.release();
+
+    // negative value means relative time (in 100 ns units)
+    ULARGE_INTEGER dueTime;
+    dueTime.QuadPart = static_cast<ULONGLONG>( -static_cast<LONGLONG>( std::chrono::duration_cast<std::chrono::nanoseconds>( delay ).count() / 100 ) );
+    FILETIME dueTimeFt{ dueTime.LowPart, dueTime.HighPart };
+    SetThreadpoolTimer( pTimer, &dueTimeFt, 0, 0 );
+
+    return pplx::create_task( event );
+}
+
+pplx::task<bool> WaitAbortableAsync( AbortManager& abortManager, pplx::task<void> task, abort_callback& abort )
+{
+    if ( abort.is_aborting() )
+    {
+        co_return false;
+    }
+
+    pplx::task_completion_event<void> abortEvent;
+    const auto abortableScope = abortManager.GetAbortableScope( [abortEvent] {
+        // abort task is invoked while abort manager lock is held:
+        // continuations must not be executed in-place, since they might destroy the scope
+        pplx::create_task( [abortEvent] { abortEvent.set(); } );
+    },
+                                                                abort );
+
+    co_await ( task || pplx::create_task( abortEvent ) );
+    co_return !abort.is_aborting();
+}
+
+} // namespace sptf
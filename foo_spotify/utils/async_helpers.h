@@ -0,0 +1,21 @@
+#pragma once
+
+#include <pplx/pplxtasks.h>
+
+#include <chrono>
+
+namespace sptf
+{
+
+class AbortManager;
+
+/// Completes after the specified delay without occupying any thread while waiting.
+pplx::task<void> DelayAsync( std::chrono::milliseconds delay );
+
+/// Waits for the task without blocking the thread.
+/// Abort only cancels the wait: the task itself is not affected.
+/// @param task must not throw
+/// @return false, if abort was signaled before the task has finished
+pplx::task<bool> WaitAbortableAsync( AbortManager& abortManager, pplx::task<void> task, abort_callback& abort );
+
+} // namespace sptf
@@ -0,0 +1,218 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace sptf
+{
+
+/// Compact binary representation of objects, used for caching.
+/// Objects are (de)serialized via `to_binary`/`from_binary` overloads (same as `to_json`/`from_json` for nlohmann json).
+/// The representation contains no field names or type info: any change in serialized fields requires a version bump by the user.
+class BinaryWriter
+{
+public:
+    BinaryWriter( std::string& data )
+        : data_( data )
+    {
+    }
+
+    void Write( const void* data, size_t size )
+    {
+        data_.append( static_cast<const char*>( data ), size );
+    }
+
+private:
+    std::string& data_;
+};
+
+class BinaryReader
+{
+public:
+    BinaryReader( std::string_view data )
+        : data_( data )
+    {
+    }
+
+    /// @throw qwr::QwrException
+    void Read( void* data, size_t size )
+    {
+        std::memcpy( data, Read( size ).data(), size );
+    }
+
+    /// @throw qwr::QwrException
+    std::string_view Read( size_t size )
+    {
+        qwr::QwrException::ExpectTrue( data_.size() - pos_ >= size, "Unexpected end of binary data" );
+
+        const auto ret = data_.substr( pos_, size );
+        pos_ += size;
+        return ret;
+    }
+
+    bool IsAtEnd() const
+    {
+        return ( pos_ == data_.size() );
+    }
+
+    size_t GetRemainingSize() const
+    {
+        return data_.size() - pos_;
+    }
+
+private:
+    std::string_view data_;
+    size_t pos_ = 0;
+};
+
+void to_binary( BinaryWriter& w, uint32_t value );
+void from_binary( BinaryReader& r, uint32_t& value );
+
+void to_binary( BinaryWriter& w, const std::string& value );
+void from_binary( BinaryReader& r, std::string& value );
+
+template <typename T>
+void to_binary( BinaryWriter& w, const std::optional<T>& value );
+template <typename T>
+void from_binary( BinaryReader& r, std::optional<T>& value );
+
+template <typename T>
+void to_binary( BinaryWriter& w, const std::unique_ptr<T>& value );
+template <typename T>
+void from_binary( BinaryReader& r, std::unique_ptr<T>& value );
+
+template <typename T>
+void to_binary( BinaryWriter& w, const std::shared_ptr<T>& value );
+template <typename T>
+void from_binary( BinaryReader& r, std::shared_ptr<T>& value );
+
+template <typename T>
+void to_binary( BinaryWriter& w, const std::vector<T>& value );
+template <typename T>
+void from_binary( BinaryReader& r, std::vector<T>& value );
+
+inline void to_binary( BinaryWriter& w, uint32_t value )
+{
+    w.Write( &value, sizeof( value ) );
+}
+
+inline void from_binary( BinaryReader& r, uint32_t& value )
+{
+    r.Read( &value, sizeof( value ) );
+}
+
+inline void to_binary( BinaryWriter& w, const std::string& value )
+{
+    to_binary( w, static_cast<uint32_t>( value.size() ) );
+    w.Write( value.data(), value.size() );
+}
+
+inline void from_binary( BinaryReader& r, std::string& value )
+{
+    uint32_t size = 0;
+    from_binary( r, size );
+    value = r.Read( size );
+}
+
+template <typename T>
+void to_binary( BinaryWriter& w, const std::optional<T>& value )
+{
+    to_binary( w, static_cast<uint32_t>( value.has_value() ) );
+    if ( value )
+    {
+        to_binary( w, *value );
+    }
+}
+
+template <typename T>
+void from_binary( BinaryReader& r, std::optional<T>& value )
+{
+    uint32_t hasValue = 0;
+    from_binary( r, hasValue );
+    if ( hasValue )
+    {
+        from_binary( r, value.emplace() );
+    }
+    else
+    {
+        value.reset();
+    }
+}
+
+template <typename T>
+void to_binary( BinaryWriter& w, const std::unique_ptr<T>& value )
+{
+    qwr::QwrException::ExpectTrue( !!value, "Can't serialize null pointer" );
+    to_binary( w, *value );
+}
+
+template <typename T>
+void from_binary( BinaryReader& r, std::unique_ptr<T>& value )
+{
+    auto pValue = std::make_unique<std::remove_const_t<T>>();
+    from_binary( r, *pValue );
+    value = std::move( pValue );
+}
+
+template <typename T>
+void to_binary( BinaryWriter& w, const std::shared_ptr<T>& value )
+{
+    qwr::QwrException::ExpectTrue( !!value, "Can't serialize null pointer" );
+    to_binary( w, *value );
+}
+
+template <typename T>
+void from_binary( BinaryReader& r, std::shared_ptr<T>& value )
+{
+    auto pValue = std::make_shared<std::remove_const_t<T>>();
+    from_binary( r, *pValue );
+    value = std::move( pValue );
+}
+
+template <typename T>
+void to_binary( BinaryWriter& w, const std::vector<T>& value )
+{
+    to_binary( w, static_cast<uint32_t>( value.size() ) );
+    for ( const auto& elem: value )
+    {
+        to_binary( w, elem );
+    }
+}
+
+template <typename T>
+void from_binary( BinaryReader& r, std::vector<T>& value )
+{
+    uint32_t size = 0;
+    from_binary( r, size );
+    // size comes from untrusted data: each element takes at least one byte,
+    // so this prevents huge allocations on corrupted data
+    qwr::QwrException::ExpectTrue( size <= r.GetRemainingSize(), "Malformed binary data: invalid array size" );
+
+    value.clear();
+    value.reserve( size );
+    for ( uint32_t i = 0; i < size; ++i )
+    {
+        from_binary( r, value.emplace_back() );
+    }
+}
+
+} // namespace sptf
+
+#define SPTF_BINARY_TO( v1 ) to_binary( sptf_binary_w, sptf_binary_t.v1 );
+#define SPTF_BINARY_FROM( v1 ) from_binary( sptf_binary_r, sptf_binary_t.v1 );
+
+#define SPTF_BINARY_DEFINE_TYPE_NON_INTRUSIVE( Type, ... )                           \
+    void to_binary( BinaryWriter& sptf_binary_w, const Type& sptf_binary_t )         \
+    {                                                                                \
+        NLOHMANN_JSON_EXPAND( NLOHMANN_JSON_PASTE( SPTF_BINARY_TO, __VA_ARGS__ ) )   \
+    }                                                                                \
+    void from_binary( BinaryReader& sptf_binary_r, Type& sptf_binary_t )             \
+    {                                                                                \
+        NLOHMANN_JSON_EXPAND( NLOHMANN_JSON_PASTE( SPTF_BINARY_FROM, __VA_ARGS__ ) ) \
+    }
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+
+namespace sptf
+{
+
+/// Bounded cache of shared immutable objects with least-recently-used eviction.
+/// Not thread-safe: all calls must be synchronized by the owner.
+template <typename KeyT, typename ValueT>
+class LruCache
+{
+public:
+    using ValuePtr = std::shared_ptr<const ValueT>;
+
+    struct Stats
+    {
+        size_t size;
+        uint64_t hits;
+        uint64_t misses;
+    };
+
+public:
+    /// @param capacity 0 - cache is disabled
+    LruCache( size_t capacity )
+        : capacity_( capacity )
+    {
+    }
+
+    /// @return nullptr, if object is not in cache
+    ValuePtr Get( const KeyT& key )
+    {
+        const auto it = index_.find( key );
+        if ( it == index_.end() )
+        {
+            ++misses_;
+            return nullptr;
+        }
+
+        ++hits_;
+        items_.splice( items_.begin(), items_, it->second );
+        return it->second->second;
+    }
+
+    bool Contains( const KeyT& key ) const
+    {
+        return ( index_.find( key ) != index_.end() );
+    }
+
+    void Put( const KeyT& key, ValuePtr pValue )
+    {
+        if ( !capacity_ )
+        {
+            return;
+        }
+
+        if ( const auto it = index_.find( key ); it != index_.end() )
+        {
+            it->second->second = std::move( pValue );
+            items_.splice( items_.begin(), items_, it->second );
+            return;
+        }
+
+        if ( items_.size() >= capacity_ )
+        {
+            index_.erase( items_.back().first );
+            items_.pop_back();
+        }
+
+        items_.emplace_front( key, std::move( pValue ) );
+        index_.emplace( key, items_.begin() );
+    }
+
+    void Erase( const KeyT& key )
+    {
+        const auto it = index_.find( key );
+        if ( it == index_.end() )
+        {
+            return;
+        }
+
+        items_.erase( it->second );
+        index_.erase( it );
+    }
+
+    Stats GetStats() const
+    {
+        return Stats{ items_.size(), hits_, misses_ };
+    }
+
+private:
+    using ItemList = std::list<std::pair<KeyT, ValuePtr>>;
+
+    const size_t capacity_;
+    ItemList items_;
+    std::unordered_map<KeyT, typename ItemList::iterator> index_;
+
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+};
+
+} // namespace sptf
@@ -0,0 +1,126 @@
+#include <stdafx.h>
+
+#include "pcm_conversion.h"
+
+#include <intrin.h>
+
+namespace
+{
+
+using namespace sptf;
+
+// int16 -> float conversion is exact and multiplication by a power of two is exact as well,
+// so all implementations produce identical results.
+constexpr float kInt16Scale = 1.0f / 32768;
+
+using ConversionFn = void ( * )( const int16_t*, float*, size_t );
+
+void ConvertScalar( const int16_t* src, float* dst, size_t count )
+{
+    for ( size_t i = 0; i < count; ++i )
+    {
+        dst[i] = src[i] * kInt16Scale;
+    }
+}
+
+void ConvertSse2( const int16_t* src, float* dst, size_t count )
+{
+    const __m128 scale = _mm_set1_ps( kInt16Scale );
+
+    size_t i = 0;
+    for ( ; i + 8 <= count; i += 8 )
+    {
+        const __m128i in = _mm_loadu_si128( reinterpret_cast<const __m128i*>( src + i ) );
+        // sign-extend by placing int16 into the upper half of int32 and shifting it back
+        const __m128i lo = _mm_srai_epi32( _mm_unpacklo_epi16( in, in ), 16 );
+        const __m128i hi = _mm_srai_epi32( _mm_unpackhi_epi16( in, in ), 16 );
+        _mm_storeu_ps( dst + i, _mm_mul_ps( _mm_cvtepi32_ps( lo ), scale ) );
+        _mm_storeu_ps( dst + i + 4, _mm_mul_ps( _mm_cvtepi32_ps( hi ), scale ) );
+    }
+
+    ConvertScalar( src + i, dst + i, count - i );
+}
+
+void ConvertAvx2( const int16_t* src, float* dst, size_t count )
+{
+    const __m256 scale = _mm256_set1_ps( kInt16Scale );
+
+    size_t i = 0;
+    for ( ; i + 16 <= count; i += 16 )
+    {
+        const __m256i lo = _mm256_cvtepi16_epi32( _mm_loadu_si128( reinterpret_cast<const __m128i*>( src + i ) ) );
+        const __m256i hi = _mm256_cvtepi16_epi32( _mm_loadu_si128( reinterpret_cast<const __m128i*>( src + i + 8 ) ) );
+        _mm256_storeu_ps( dst + i, _mm256_mul_ps( _mm256_cvtepi32_ps( lo ), scale ) );
+        _mm256_storeu_ps( dst + i + 8, _mm256_mul_ps( _mm256_cvtepi32_ps( hi ), scale ) );
+    }
+    _mm256_zeroupper();
+
+    ConvertSse2( src + i, dst + i, count - i );
+}
+
+bool HasSse2()
+{
+    int cpuInfo[4]{};
+    __cpuid( cpuInfo, 1 );
+    return ( cpuInfo[3] & ( 1 << 26 ) );
+}
+
+bool HasAvx2()
+{
+    int cpuInfo[4]{};
+    __cpuid( cpuInfo, 0 );
+    if ( cpuInfo[0] < 7 )
+    {
+        return false;
+    }
+
+    __cpuid( cpuInfo, 1 );
+    const bool hasOsXsave = ( cpuInfo[2] & ( 1 << 27 ) );
+    const bool hasAvx = ( cpuInfo[2] & ( 1 << 28 ) );
+    if ( !hasOsXsave || !hasAvx )
+    {
+        return false;
+    }
+
+    // OS must preserve YMM registers
+    if ( ( _xgetbv( 0 ) & 0x6 ) != 0x6 )
+    {
+        return false;
+    }
+
+    __cpuidex( cpuInfo, 7, 0 );
+    return ( cpuInfo[1] & ( 1 << 5 ) );
+}
+
+ConversionFn SelectConversionFn()
+{
+    if ( HasAvx2() )
+    {
+        return ConvertAvx2;
+    }
+    if ( HasSse2() )
+    {
+        return ConvertSse2;
+    }
+    return ConvertScalar;
+}
+
+} // namespace
+
+namespace sptf::pcm
+{
+
+void ConvertInt16ToFloat( const int16_t* src, audio_sample* dst, size_t count )
+{
+#if audio_sample_size == 32
+    static const auto pfnConvert = SelectConversionFn();
+    pfnConvert( src, dst, count );
+#else
+    for ( size_t i = 0; i < count; ++i )
+    {
+        dst[i] = static_cast<audio_sample>( src[i] ) / 32768;
+    }
+#endif
+}
+
+} // namespace sptf::pcm
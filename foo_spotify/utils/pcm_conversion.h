@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdint>
+
+namespace sptf::pcm
+{
+
+/// Converts signed 16-bit PCM to `audio_sample` in [-1.0, 1.0) range.
+/// Uses AVX2 or SSE2 implementation if supported by CPU, output is bit-exact with the scalar one.
+void ConvertInt16ToFloat( const int16_t* src, audio_sample* dst, size_t count );
+
+} // namespace sptf::pcm
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <utils/abort_manager.h>
+#include <utils/async_helpers.h>
+
+#include <pplawait.h>
+#include <pplx/pplxtasks.h>
+
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <experimental/resumable>
+
+namespace sptf
+{
+
+/// Collects single-key requests made within a short time window and executes them as a single batched request.
+/// The first caller in the window executes the request, the rest wait for its result.
+/// Neither the window nor the waits occupy any threads.
+/// Abort only cancels the wait of the aborted caller: if the executing caller is aborted,
+/// the waiting callers try again with a new batch.
+template <typename KeyT, typename ValueT>
+class RequestBatcher
+{
+    struct Batch
+    {
+        std::vector<KeyT> keys;
+        /// Set when the batch is full
+        pplx::task_completion_event<void> closedEvent;
+        /// Set after the results are filled in
+        pplx::task_completion_event<void> doneEvent;
+        bool isAbandoned = false;
+        std::vector<ValueT> results;
+        std::exception_ptr pException;
+    };
+
+public:
+    /// @param fn must return values in the same order as keys
+    using FetchFn = std::function<pplx::task<std::vector<ValueT>>( std::vector<KeyT> keys, abort_callback& abort )>;
+
+public:
+    RequestBatcher( AbortManager& abortManager, size_t maxBatchSize, std::chrono::milliseconds window, FetchFn fn )
+        : abortManager_( abortManager )
+        , maxBatchSize_( maxBatchSize )
+        , window_( window )
+        , fn_( fn )
+    {
+    }
+
+    /// @throw qwr::QwrException
+    /// @throw any exception thrown by fetch function
+    pplx::task<ValueT> ExecuteAsync( KeyT key, abort_callback& abort )
+    {
+        while ( true )
+        {
+            std::shared_ptr<Batch> pBatch;
+            bool isExecutor = false;
+            bool isFull = false;
+            size_t keyIdx = 0;
+            {
+                std::lock_guard lock( mutex_ );
+
+                isExecutor = !pOpenBatch_;
+                if ( isExecutor )
+                {
+                    pOpenBatch_ = std::make_shared<Batch>();
+                }
+
+                pBatch = pOpenBatch_;
+                keyIdx = pBatch->keys.size();
+                pBatch->keys.emplace_back( key );
+                isFull = ( pBatch->keys.size() >= maxBatchSize_ );
+                if ( isFull )
+                { // no need to wait for the window to end
+                    pOpenBatch_.reset();
+                }
+            }
+            if ( isFull )
+            { // not under lock: continuation of the executor might be executed in-place
+                pBatch->closedEvent.set();
+            }
+
+            if ( isExecutor )
+            {
+                (void)co_await WaitAbortableAsync( abortManager_, DelayAsync( window_ ) || pplx::create_task( pBatch->closedEvent ), abort );
+                {
+                    std::lock_guard lock( mutex_ );
+                    if ( pOpenBatch_ == pBatch )
+                    {
+                        pOpenBatch_.reset();
+                    }
+                }
+
+                co_return co_await ExecuteBatchAsync( pBatch, abort );
+            }
+
+            const auto isDone = co_await WaitAbortableAsync( abortManager_, pplx::create_task( pBatch->doneEvent ), abort );
+            qwr::QwrException::ExpectTrue( isDone, "Abort was signaled, canceling request..." );
+
+            if ( pBatch->isAbandoned )
+            { // executing caller was aborted: try again
+                continue;
+            }
+            if ( pBatch->pException )
+            {
+                std::rethrow_exception( pBatch->pException );
+            }
+
+            co_return pBatch->results[keyIdx];
+        }
+    }
+
+private:
+    pplx::task<ValueT> ExecuteBatchAsync( std::shared_ptr<Batch> pBatch, abort_callback& abort )
+    {
+        // batch is closed at this point, so keys won't change
+        std::vector<ValueT> results;
+        std::exception_ptr pException;
+        try
+        {
+            results = co_await fn_( pBatch->keys, abort );
+            qwr::QwrException::ExpectTrue( results.size() == pBatch->keys.size(), "Internal error: batched request returned unexpected number of results" );
+        }
+        catch ( ... )
+        {
+            pException = std::current_exception();
+        }
+
+        if ( pException && abort.is_aborting() )
+        { // abort of this caller should not affect the others
+            pBatch->isAbandoned = true;
+        }
+        else
+        {
+            pBatch->results = results;
+            pBatch->pException = pException;
+        }
+        pBatch->doneEvent.set();
+
+        if ( pException )
+        {
+            std::rethrow_exception( pException );
+        }
+
+        // executor's key is always the first one
+        co_return results[0];
+    }
+
+private:
+    AbortManager& abortManager_;
+    const size_t maxBatchSize_;
+    const std::chrono::milliseconds window_;
+    const FetchFn fn_;
+
+    std::mutex mutex_;
+    std::shared_ptr<Batch> pOpenBatch_;
+};
+
+} // namespace sptf
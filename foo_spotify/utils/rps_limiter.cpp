@@ -1,95 +1,117 @@
-
 #include <stdafx.h>
 
 #include "rps_limiter.h"
 
-#include <backend/spotify_instance.h>
 #include <fb2k/advanced_config.h>
-#include <utils/abort_manager.h>
-#include <utils/sleeper.h>
 
-#include <qwr/final_action.h>
+#include <algorithm>
+
+using namespace std::literals::chrono_literals;
 
 namespace
 {
 
-std::chrono::milliseconds GetTimestampInMs()
-{
-    return std::chrono::time_point_cast<std::chrono::milliseconds>( std::chrono::system_clock::now() ).time_since_epoch();
-}
+constexpr double kMinRpsFraction = 0.1;
+constexpr double kBackoffFactor = 0.5;
+constexpr double kRecoveryStep = 0.1;
 
 } // namespace
 
 namespace sptf
 {
 
-RpsLimiter::RpsLimiter( size_t limit, std::chrono::seconds limitPeriod )
+RpsLimiter::RpsLimiter( double maxRps, size_t burst )
     : shouldLogWebApiDebug_( config::advanced::logging_webapi_debug )
-    , limitPeriod_( limitPeriod )
-    , limitCount_( limit )
-    , timeStampsContainer_( limit, GetTimestampInMs() - 2 * limitPeriod )
-    , timeStamps_( timeStampsContainer_.begin(), timeStampsContainer_.end(), timeStampsContainer_.begin(), timeStampsContainer_.size() )
+    , maxRps_( maxRps )
+    , minRps_( maxRps * kMinRpsFraction )
+    , burst_( static_cast<double>( std::max<size_t>( burst, 1 ) ) )
+    , rps_( maxRps )
+    , tokens_( burst_ )
+    , lastRefillTime_( Clock::now() )
+    , pausedUntil_( lastRefillTime_ )
 {
 }
 
-void RpsLimiter::WaitForRequestAvailability( abort_callback& abort )
+std::chrono::milliseconds RpsLimiter::TryAcquire()
 {
-    if ( abort.is_aborting() )
+    std::lock_guard lock( mutex_ );
+
+    const auto now = Clock::now();
+    Refill_NonBlocking( now );
+    if ( now >= pausedUntil_ && tokens_ >= 1 )
     {
-        return;
+        tokens_ -= 1;
+        return 0ms;
     }
 
-    std::atomic_bool timeToDie = false;
-    auto& am = SpotifyInstance::Get().GetAbortManager();
-    const auto abortableScope = am.GetAbortableScope( [&] {
-        timeToDie = true;
-        cv_.notify_all();
-    },
-                                                      abort );
-
-    std::unique_lock lock( mutex_ );
+    const auto waitTime = [&] {
+        if ( now < pausedUntil_ )
+        {
+            return std::chrono::duration_cast<std::chrono::milliseconds>( pausedUntil_ - now ) + 1ms;
+        }
+        return std::chrono::milliseconds( static_cast<int64_t>( ( 1 - tokens_ ) * 1000 / rps_ ) + 1 );
+    }();
+    // caller is expected to wait for the whole duration
+    throttleTime_ += waitTime;
 
-    const auto nowInMs = GetTimestampInMs();
-    auto nextAvailableTime = timeStamps_.front() + limitPeriod_;
-    if ( incomingRequests_.empty() && nowInMs >= nextAvailableTime )
+    if ( shouldLogWebApiDebug_ )
     {
-        timeStamps_.emplace_back( nowInMs );
-        return;
+        FB2K_console_formatter() << SPTF_UNDERSCORE_NAME " (debug):\n"
+                                 << fmt::format( "throttling for {} milliseconds", waitTime.count() );
     }
 
-    auto waitTime = nextAvailableTime - nowInMs;
+    return waitTime;
+}
+
+void RpsLimiter::ReportRateLimited( std::chrono::milliseconds retryAfter )
+{
+    std::lock_guard lock( mutex_ );
+
+    const auto now = Clock::now();
+    Refill_NonBlocking( now );
 
-    const auto requestIdx = curRequestIdx_++;
-    incomingRequests_.emplace_back( requestIdx );
-    const auto curIt = std::prev( incomingRequests_.end() );
-    const qwr::final_action autoEraseRequest( [&] {
-        incomingRequests_.erase( curIt );
-    } );
+    rps_ = std::max( minRps_, rps_ * kBackoffFactor );
+    // single request right after the pause, no burst
+    tokens_ = 1;
+    pausedUntil_ = std::max( pausedUntil_, now + retryAfter );
+    ++rateLimitErrors_;
 
-    while ( true )
+    if ( shouldLogWebApiDebug_ )
     {
-        if ( shouldLogWebApiDebug_ )
-        {
-            FB2K_console_formatter() << SPTF_UNDERSCORE_NAME " (debug):\n"
-                                     << fmt::format( "throttling for {} milliseconds", waitTime.count() );
-        }
+        FB2K_console_formatter() << SPTF_UNDERSCORE_NAME " (debug):\n"
+                                 << fmt::format( "rate limit reached: pausing requests for {} ms, rate reduced to {:.2f} rps", retryAfter.count(), rps_ );
+    }
+}
 
-        bool hasEvent = cv_.wait_for( lock, waitTime, [&] {
-            return timeToDie || ( incomingRequests_.front() == requestIdx && GetTimestampInMs() >= nextAvailableTime );
-        } );
+void RpsLimiter::ReportSuccess()
+{
+    std::lock_guard lock( mutex_ );
 
-        if ( hasEvent )
-        {
-            if ( !timeToDie )
-            {
-                timeStamps_.emplace_back( GetTimestampInMs() );
-            }
-            return;
-        }
+    if ( rps_ >= maxRps_ )
+    {
+        return;
+    }
 
-        nextAvailableTime = GetTimestampInMs() + limitPeriod_ / limitCount_;
-        waitTime = limitPeriod_ / limitCount_;
+    Refill_NonBlocking( Clock::now() );
+    rps_ = std::min( maxRps_, rps_ + maxRps_ * kRecoveryStep );
+}
+
+RpsLimiter::Metrics RpsLimiter::GetMetrics()
+{
+    std::lock_guard lock( mutex_ );
+    return Metrics{ rps_, throttleTime_, rateLimitErrors_ };
+}
+
+void RpsLimiter::Refill_NonBlocking( Clock::time_point now )
+{
+    // tokens are not accumulated while paused
+    const auto refillStartTime = std::max( lastRefillTime_, pausedUntil_ );
+    if ( now > refillStartTime )
+    {
+        const auto elapsedSeconds = std::chrono::duration<double>( now - refillStartTime ).count();
+        tokens_ = std::min( burst_, tokens_ + elapsedSeconds * rps_ );
     }
+    lastRefillTime_ = now;
 }
 
 } // namespace sptf
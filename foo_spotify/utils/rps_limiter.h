@@ -1,41 +1,60 @@
 #pragma once
 
-#include <nonstd/ring_span.hpp>
-
 #include <chrono>
-#include <list>
+#include <cstdint>
 #include <mutex>
-#include <vector>
 
 namespace sptf
 {
 
+/// Token bucket limiter: up to `burst` requests can be made at once, tokens are refilled with the current rate.
+/// The rate is shared by all callers: it is decreased multiplicatively when server reports throttling
+/// and is restored additively on successful requests.
+/// Limiter itself never blocks: callers are expected to wait asynchronously and try again.
 class RpsLimiter
 {
 public:
-    RpsLimiter( size_t limit, std::chrono::seconds limitPeriod = std::chrono::seconds( 1 ) );
+    struct Metrics
+    {
+        double currentRps;
+        std::chrono::milliseconds throttleTime;
+        uint64_t rateLimitErrors;
+    };
+
+public:
+    RpsLimiter( double maxRps, size_t burst );
     ~RpsLimiter() = default;
 
-    void WaitForRequestAvailability( abort_callback& abort );
+    /// @return 0, if request can be made right away, otherwise time until the next request slot
+    std::chrono::milliseconds TryAcquire();
+
+    /// Pauses all requests for `retryAfter` and reduces the rate.
+    void ReportRateLimited( std::chrono::milliseconds retryAfter );
+    void ReportSuccess();
+
+    Metrics GetMetrics();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void Refill_NonBlocking( Clock::time_point now );
 
 private:
     const bool shouldLogWebApiDebug_;
 
-    const std::chrono::seconds limitPeriod_;
-    const size_t limitCount_;
+    const double maxRps_;
+    const double minRps_;
+    const double burst_;
 
     std::mutex mutex_;
-    std::condition_variable cv_;
 
-    std::vector<std::chrono::milliseconds> timeStampsContainer_;
-    nonstd::ring_span<
-        std::chrono::milliseconds,
-        nonstd::null_popper<std::chrono::milliseconds>>
-        timeStamps_;
+    double rps_;
+    double tokens_;
+    Clock::time_point lastRefillTime_;
+    Clock::time_point pausedUntil_;
 
-    size_t curRequestIdx_ = 0;
-    // TODO: replace list with queue
-    std::list<size_t> incomingRequests_;
+    std::chrono::milliseconds throttleTime_{};
+    uint64_t rateLimitErrors_ = 0;
 };
 
 } // namespace sptf
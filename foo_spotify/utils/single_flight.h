@@ -0,0 +1,137 @@
+#pragma once
+
+#include <utils/abort_manager.h>
+#include <utils/async_helpers.h>
+
+#include <pplawait.h>
+#include <pplx/pplxtasks.h>
+
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+#include <experimental/resumable>
+
+namespace sptf
+{
+
+/// Coalesces concurrent requests with the same key:
+/// only the first caller executes the request, the rest wait for its result.
+/// Waiting callers don't occupy any threads.
+/// Abort only cancels the wait of the aborted caller: if the executing caller is aborted,
+/// one of the waiting callers executes the request instead.
+template <typename KeyT, typename ValueT>
+class SingleFlight
+{
+    struct Flight
+    {
+        /// Set after the result is filled in
+        pplx::task_completion_event<void> doneEvent;
+        bool isAbandoned = false;
+        std::optional<ValueT> result;
+        std::exception_ptr pException;
+    };
+
+public:
+    SingleFlight( AbortManager& abortManager )
+        : abortManager_( abortManager )
+    {
+    }
+
+    /// @param fn must return `pplx::task<ValueT>`
+    /// @throw qwr::QwrException
+    /// @throw any exception thrown by `fn`
+    template <typename Fn>
+    pplx::task<ValueT> ExecuteAsync( KeyT key, Fn fn, abort_callback& abort )
+    {
+        while ( true )
+        {
+            std::shared_ptr<Flight> pFlight;
+            bool isExecutor = false;
+            {
+                std::lock_guard lock( mutex_ );
+
+                if ( const auto it = flights_.find( key ); it != flights_.end() )
+                {
+                    pFlight = it->second;
+                }
+                else
+                {
+                    pFlight = std::make_shared<Flight>();
+                    flights_.emplace( key, pFlight );
+                    isExecutor = true;
+                }
+            }
+
+            if ( isExecutor )
+            {
+                co_return co_await ExecuteFlightAsync( key, pFlight, fn, abort );
+            }
+
+            const auto isDone = co_await WaitAbortableAsync( abortManager_, pplx::create_task( pFlight->doneEvent ), abort );
+            qwr::QwrException::ExpectTrue( isDone, "Abort was signaled, canceling request..." );
+
+            if ( pFlight->isAbandoned )
+            { // executing caller was aborted: try again
+                continue;
+            }
+            if ( pFlight->pException )
+            {
+                std::rethrow_exception( pFlight->pException );
+            }
+
+            assert( pFlight->result );
+            co_return *pFlight->result;
+        }
+    }
+
+private:
+    template <typename Fn>
+    pplx::task<ValueT> ExecuteFlightAsync( KeyT key, std::shared_ptr<Flight> pFlight, Fn& fn, abort_callback& abort )
+    {
+        std::optional<ValueT> resultOpt;
+        std::exception_ptr pException;
+        try
+        {
+            resultOpt = co_await fn();
+        }
+        catch ( ... )
+        {
+            pException = std::current_exception();
+        }
+
+        {
+            std::lock_guard lock( mutex_ );
+            flights_.erase( key );
+        }
+
+        if ( pException && abort.is_aborting() )
+        { // abort of this caller should not affect the others
+            pFlight->isAbandoned = true;
+        }
+        else
+        {
+            pFlight->result = resultOpt;
+            pFlight->pException = pException;
+        }
+        // not under lock: continuations of waiters might be executed in-place
+        pFlight->doneEvent.set();
+
+        if ( pException )
+        {
+            std::rethrow_exception( pException );
+        }
+
+        co_return std::move( *resultOpt );
+    }
+
+private:
+    AbortManager& abortManager_;
+
+    std::mutex mutex_;
+    std::unordered_map<KeyT, std::shared_ptr<Flight>> flights_;
+};
+
+} // namespace sptf